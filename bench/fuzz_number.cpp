@@ -0,0 +1,131 @@
+// Fuzz target for parseMilli() in fixed_point.h.
+//
+// With libFuzzer (clang):
+//   make p1fuzz_number CXX=clang++ FUZZ_FLAGS="-fsanitize=fuzzer,address,undefined"
+//   ./p1fuzz_number
+// With any other compiler it builds with its own driver, which mutates typical meter
+// values under ASan/UBSan for a fixed number of runs:
+//   make p1fuzz_number && ./p1fuzz_number [runs]
+//
+// Every input is copied to a buffer of exactly its size, so ASan catches any read past
+// len. What parses has to match a plain reference parse of the same text.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "p1reader/fixed_point.h"
+
+using namespace esphome::p1_reader;
+
+namespace
+{
+    // Straightforward and slow: validate with the grammar, then sum digit by digit
+    void reference(const std::string &text, NumberResult *result, int64_t *milli)
+    {
+        size_t i = 0;
+        bool negative = !text.empty() && text[0] == '-';
+        i += negative;
+
+        std::string intDigits;
+        std::string decDigits;
+        bool point = false;
+        for (; i < text.size(); i++)
+        {
+            char c = text[i];
+            if (c == '.' && !point)
+                point = true;
+            else if (c >= '0' && c <= '9')
+                (point ? decDigits : intDigits) += c;
+            else
+                break;
+        }
+
+        if (intDigits.empty() && decDigits.empty())
+            *result = text.size() == (size_t) negative ? NUMBER_EMPTY : NUMBER_INVALID;
+        else if (intDigits.size() - std::min(intDigits.find_first_not_of('0'), intDigits.size()) > MAX_INTEGER_DIGITS)
+            *result = NUMBER_OVERFLOW;
+        else if (i != text.size())
+            *result = NUMBER_INVALID;
+        else
+            *result = NUMBER_OK;
+
+        if (*result != NUMBER_OK)
+            return;
+
+        int64_t value = 0;
+        for (char c : intDigits)
+            value = value * 10 + (c - '0');
+        decDigits.resize(3, '0');
+        for (char c : decDigits.substr(0, 3))
+            value = value * 10 + (c - '0');
+        *milli = negative ? -value : value;
+    }
+
+    void check(const uint8_t *data, size_t size)
+    {
+        // Exactly size bytes on the heap, nothing after them to read by accident
+        char *text = (char *) malloc(size ? size : 1);
+        memcpy(text, data, size);
+
+        int64_t milli = 0x5a5a5a5a;
+        NumberResult result = parseMilli(text, size, &milli);
+
+        NumberResult expected;
+        int64_t expectedMilli = 0x5a5a5a5a;
+        std::string copy(text, size);
+        reference(copy, &expected, &expectedMilli);
+
+        if (result != expected || milli != expectedMilli)
+        {
+            fprintf(stderr, "Mismatch on \"%s\": %s %lld, expected %s %lld\n", copy.c_str(),
+                    numberResultText(result), (long long) milli,
+                    numberResultText(expected), (long long) expectedMilli);
+            abort();
+        }
+        free(text);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    check(data, size);
+    return 0;
+}
+
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+int main(int argc, char **argv)
+{
+    long runs = argc > 1 ? atol(argv[1]) : 1000000;
+
+    const char *seeds[] = {"00006678.394", "0001.617", "230.0", "-0.5", "42", "99999999.999",
+                           "999999999999999.999", "1000000000000000", "230101120000W", ""};
+    const char alphabet[] = "0123456789.-+ eE*()";
+
+    std::mt19937 rng(1);
+    std::string text;
+    for (long run = 0; run < runs; run++)
+    {
+        text = seeds[rng() % (sizeof(seeds) / sizeof(seeds[0]))];
+        int edits = rng() % 4;
+        for (int e = 0; e < edits; e++)
+        {
+            size_t pos = text.empty() ? 0 : rng() % (text.size() + 1);
+            switch (rng() % 4)
+            {
+                case 0: text.insert(pos, 1, alphabet[rng() % (sizeof(alphabet) - 1)]); break;
+                case 1: if (pos < text.size()) text.erase(pos, 1); break;
+                case 2: if (pos < text.size()) text[pos] = (char) rng(); break;
+                case 3: text.insert(pos, rng() % 20, '9'); break;
+            }
+        }
+        check((const uint8_t *) text.data(), text.size());
+    }
+
+    printf("%ld runs, no mismatch\n", runs);
+    return 0;
+}
+#endif
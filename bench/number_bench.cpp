@@ -0,0 +1,263 @@
+// Checks parseMilli() in fixed_point.h against a table of values, and the range of the
+// slots it parses into, and times it against the parsers it replaced, over the values of
+// the bundled telegrams.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "p1reader/ascii_line.h"
+#include "p1reader/fixed_point.h"
+#include "p1reader/parsed_message.h"
+
+using namespace esphome::p1_reader;
+
+namespace
+{
+    // The first parser, as it was: reads up to a '.' and on to the terminator, decimals
+    // past the table or values past 2^31 go wrong. Only fed values it gets right here.
+    double legacySimpleatof(const char* value)
+    {
+        double decFactors[10] = {10.0, 100.0, 1000.0, 100000.0,
+                                1000000.0, 10000000.0, 100000000.0,
+                                1000000000.0, 10000000000.0,
+                                100000000000.0};
+        int idx = 0;
+        int intPart = 0;
+        bool negative = false;
+
+        if (value[idx] == '-')
+        {
+            negative = true;
+            idx++;
+        }
+
+        while (value[idx] != '.')
+        {
+            intPart = intPart*10 + (value[idx]-'0');
+            idx++;
+        }
+
+        int len = strlen(value), startIdx = ++idx;
+        int decPart = 0;
+        while (idx < len)
+        {
+            decPart = decPart*10 + (value[idx]-'0');
+            idx++;
+        }
+
+        if (negative)
+        {
+            return -(intPart + decPart / decFactors[len - startIdx - 1]);
+        }
+        return intPart + decPart / decFactors[len - startIdx - 1];
+    }
+
+    // The bounded parser before parseMilli(): stays inside len but takes any character
+    // for a digit
+    int64_t legacySimpleatofixed(const char* value, size_t len)
+    {
+        size_t idx = 0;
+        int64_t intPart = 0;
+        bool negative = false;
+
+        if (idx < len && value[idx] == '-')
+        {
+            negative = true;
+            idx++;
+        }
+
+        while (idx < len && value[idx] != '.')
+        {
+            intPart = intPart*10 + (value[idx]-'0');
+            idx++;
+        }
+
+        int32_t decPart = 0;
+        int32_t decFactor = 100;
+        idx++;
+        while (idx < len && decFactor > 0)
+        {
+            decPart += (value[idx]-'0') * decFactor;
+            decFactor /= 10;
+            idx++;
+        }
+
+        int64_t milli = intPart*1000 + decPart;
+        return negative ? -milli : milli;
+    }
+
+    struct Case
+    {
+        const char *text;
+        NumberResult result;
+        int64_t milli;
+    };
+
+    const Case CASES[] = {
+        {"00006678.394", NUMBER_OK, 6678394},
+        {"0001.617", NUMBER_OK, 1617},
+        {"230.0", NUMBER_OK, 230000},
+        {"-0.5", NUMBER_OK, -500},
+        {"12.3456789", NUMBER_OK, 12345},
+        {"42", NUMBER_OK, 42000},
+        {"0000000000000000000042.1", NUMBER_OK, 42100},
+        {"7.", NUMBER_OK, 7000},
+        {".25", NUMBER_OK, 250},
+        {"99999999.999", NUMBER_OK, 99999999999},
+        {"999999999999999.999", NUMBER_OK, 999999999999999999},
+        {"-999999999999999.999", NUMBER_OK, -999999999999999999},
+        {"1000000000000000", NUMBER_OVERFLOW, 0},
+        {"", NUMBER_EMPTY, 0},
+        {"-", NUMBER_EMPTY, 0},
+        {".", NUMBER_INVALID, 0},
+        {"-.", NUMBER_INVALID, 0},
+        {"1.2.3", NUMBER_INVALID, 0},
+        {"12a", NUMBER_INVALID, 0},
+        {"1 2", NUMBER_INVALID, 0},
+        {"+1", NUMBER_INVALID, 0},
+        {"--1", NUMBER_INVALID, 0},
+        {"1.x", NUMBER_INVALID, 0},
+        {"/", NUMBER_INVALID, 0},
+        {":", NUMBER_INVALID, 0},
+        {"230101120000W", NUMBER_INVALID, 0},
+    };
+
+    bool verify()
+    {
+        bool ok = true;
+        for (const Case &c : CASES)
+        {
+            int64_t milli = 0;
+            NumberResult result = parseMilli(c.text, strlen(c.text), &milli);
+            if (result != c.result || (result == NUMBER_OK && milli != c.milli))
+            {
+                printf("FAIL \"%s\": %s %lld, expected %s %lld\n", c.text,
+                       numberResultText(result), (long long) milli,
+                       numberResultText(c.result), (long long) c.milli);
+                ok = false;
+            }
+        }
+
+        // The length is all there is, the rest of the buffer is never looked at
+        int64_t milli = 0;
+        if (parseMilli("1.5)(2", 3, &milli) != NUMBER_OK || milli != 1500)
+        {
+            printf("FAIL value followed by more text\n");
+            ok = false;
+        }
+
+        // Momentary slots are 32 bits, a value past that is turned away rather than wrapped
+        ParsedMessage message;
+        message.initNewTelegram();
+        const char big[] = "99999999.999";
+        if (message.parseRow(obisKey(1, 0, 1, 7, 0), big, strlen(big), ~(SlotMask) 0) != NUMBER_OVERFLOW ||
+            message.sensorsToSend != 0)
+        {
+            printf("FAIL momentary value past 32 bits\n");
+            ok = false;
+        }
+        if (message.parseRow(obisKey(1, 0, 1, 8, 0), big, strlen(big), ~(SlotMask) 0) != NUMBER_OK ||
+            message.getMilli(SLOT_CUMULATIVE_ACTIVE_IMPORT) != 99999999999)
+        {
+            printf("FAIL cumulative value past 32 bits\n");
+            ok = false;
+        }
+        return ok;
+    }
+
+    // The values of every data line of an ASCII telegram, as they sit in the line
+    std::vector<std::string> loadValues(const char *path)
+    {
+        std::vector<std::string> values;
+        FILE *f = fopen(path, "r");
+        if (f == nullptr)
+            return values;
+
+        char line[1024];
+        while (fgets(line, sizeof(line), f) != nullptr)
+        {
+            AsciiLine parts;
+            if (!AsciiLine::tokenize(line, strcspn(line, "\r\n"), &parts))
+                continue;
+            int64_t milli;
+            std::string value(parts.value.in(line), parts.value.length);
+            // Text values (timestamps, ids) aren't numbers and would throw off the old parsers
+            if (parseMilli(value.data(), value.size(), &milli) == NUMBER_OK && value.find('.') != std::string::npos)
+                values.push_back(value);
+        }
+        fclose(f);
+        return values;
+    }
+
+    // Best of a few repeats, a few ns per value are easily lost to the machine
+    template <typename F>
+    double timeParser(const std::vector<std::string> &values, int rounds, F parse)
+    {
+        volatile int64_t sink = 0;
+        double best = 0;
+        for (int repeat = 0; repeat < 5; repeat++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < rounds; r++)
+            {
+                for (const std::string &v : values)
+                    sink = sink + parse(v);
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            if (repeat == 0 || ns < best)
+                best = ns;
+        }
+        return best / ((double) rounds * values.size());
+    }
+}
+
+int main()
+{
+    if (!verify())
+        return 1;
+
+    std::vector<std::string> values = loadValues(BENCH_DATA_DIR "/ascii_sagemcom_t211.txt");
+    std::vector<std::string> dsmr = loadValues(BENCH_DATA_DIR "/ascii_dsmr5.txt");
+    values.insert(values.end(), dsmr.begin(), dsmr.end());
+    if (values.empty())
+    {
+        printf("No values found in " BENCH_DATA_DIR "\n");
+        return 1;
+    }
+
+    // All three have to agree on what the meters send
+    for (const std::string &v : values)
+    {
+        int64_t milli = 0;
+        parseMilli(v.data(), v.size(), &milli);
+        int64_t fixed = legacySimpleatofixed(v.data(), v.size());
+        int64_t fromDouble = (int64_t) (legacySimpleatof(v.c_str()) * 1000.0 + (milli < 0 ? -0.5 : 0.5));
+        if (fixed != milli || fromDouble != milli)
+        {
+            printf("FAIL \"%s\": parseMilli %lld, simpleatofixed %lld, simpleatof %lld\n", v.c_str(),
+                   (long long) milli, (long long) fixed, (long long) fromDouble);
+            return 1;
+        }
+    }
+
+    const int ROUNDS = 50000;
+    printf("%zu values\n", values.size());
+    printf("%-16s %10s\n", "parser", "ns/value");
+    printf("%-16s %10.2f\n", "simpleatof", timeParser(values, ROUNDS, [](const std::string &v) {
+        return (int64_t) (legacySimpleatof(v.c_str()) * 1000.0);
+    }));
+    printf("%-16s %10.2f\n", "simpleatofixed", timeParser(values, ROUNDS, [](const std::string &v) {
+        return legacySimpleatofixed(v.data(), v.size());
+    }));
+    printf("%-16s %10.2f\n", "parseMilli", timeParser(values, ROUNDS, [](const std::string &v) {
+        int64_t milli = 0;
+        parseMilli(v.data(), v.size(), &milli);
+        return milli;
+    }));
+
+    return 0;
+}
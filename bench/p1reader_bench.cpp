@@ -0,0 +1,557 @@
+// Host-side replay benchmark for the p1reader component.
+//
+// Compiles the real p1reader.cpp against the stand-ins in stubs/, replays a
+// recorded telegram through a simulated UART at a chosen baud rate and calls
+// update() the way the ESPHome scheduler would. Reports parser throughput
+// (bytes/s and telegrams/s of CPU time on this host) and the worst-case time
+// of a single update() call, which is what ESPHome warns about on the device.
+//
+// With a list of protocols one reader is set up per entry, each on its own
+// UART, the way several meters are read from one device.
+//
+// Host numbers are not device numbers, but they are repeatable, so they are
+// good for comparing one parser change against the next.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "p1reader/p1reader.h"
+
+using namespace esphome;
+
+namespace
+{
+    struct Options
+    {
+        std::vector<std::string> protocols;
+        std::vector<std::string> files;
+        std::string sensors;
+        std::string deadband;
+        std::string readMode = "polling";
+        std::string decryptionKey;
+        std::string authenticationKey;
+        uint32_t loopMs = 16;
+        uint32_t timeBudgetMs = 20;
+        uint32_t publishCostUs = 0;
+        uint32_t maxIntervalMs = 0;
+        uint32_t baud = 115200;
+        uint32_t telegrams = 200;
+        uint32_t intervalMs = 1000;
+        size_t rxBufferSize = 3072;
+        uint16_t bufferSize = 1024;
+        bool values = false;
+        bool repeat = false;
+        bool capture = false;
+        bool dumpTrace = false;
+    };
+
+    // Exposes the protected bits of P1Reader the bench needs to drive it
+    class BenchReader : public p1_reader::P1Reader
+    {
+    public:
+        using P1Reader::P1Reader;
+
+        uint32_t telegramsPublished() const { return _telegramsPublished; }
+        bool publishPending() const { return _publishing != nullptr; }
+
+        // One wake-up of the ESP32 reader task, which the bench runs in between loop() calls
+        void readerTaskStep()
+        {
+            if (stageRxBytes() > 0 || _captureState == CAPTURE_PARSING)
+            {
+                _readBudget->startSlice();
+                (this->*readP1Message)();
+            }
+        }
+    };
+
+    struct NamedSensor
+    {
+        const char *name;
+        void (p1_reader::P1Reader::*setter)(sensor::Sensor *);
+    };
+
+    const NamedSensor SENSORS[] = {
+        {"cumulative_active_import", &p1_reader::P1Reader::set_sensor_cumulative_active_import},
+        {"cumulative_active_export", &p1_reader::P1Reader::set_sensor_cumulative_active_export},
+        {"cumulative_reactive_import", &p1_reader::P1Reader::set_sensor_cumulative_reactive_import},
+        {"cumulative_reactive_export", &p1_reader::P1Reader::set_sensor_cumulative_reactive_export},
+        {"cumulative_active_import_t1", &p1_reader::P1Reader::set_sensor_cumulative_active_import_t1},
+        {"cumulative_active_import_t2", &p1_reader::P1Reader::set_sensor_cumulative_active_import_t2},
+        {"cumulative_active_export_t1", &p1_reader::P1Reader::set_sensor_cumulative_active_export_t1},
+        {"cumulative_active_export_t2", &p1_reader::P1Reader::set_sensor_cumulative_active_export_t2},
+        {"mbus_1_reading", &p1_reader::P1Reader::set_sensor_mbus_1_reading},
+        {"mbus_2_reading", &p1_reader::P1Reader::set_sensor_mbus_2_reading},
+        {"mbus_3_reading", &p1_reader::P1Reader::set_sensor_mbus_3_reading},
+        {"mbus_4_reading", &p1_reader::P1Reader::set_sensor_mbus_4_reading},
+        {"momentary_active_import", &p1_reader::P1Reader::set_sensor_momentary_active_import},
+        {"momentary_active_export", &p1_reader::P1Reader::set_sensor_momentary_active_export},
+        {"momentary_reactive_import", &p1_reader::P1Reader::set_sensor_momentary_reactive_import},
+        {"momentary_reactive_export", &p1_reader::P1Reader::set_sensor_momentary_reactive_export},
+        {"momentary_active_import_l1", &p1_reader::P1Reader::set_sensor_momentary_active_import_l1},
+        {"momentary_active_export_l1", &p1_reader::P1Reader::set_sensor_momentary_active_export_l1},
+        {"momentary_active_import_l2", &p1_reader::P1Reader::set_sensor_momentary_active_import_l2},
+        {"momentary_active_export_l2", &p1_reader::P1Reader::set_sensor_momentary_active_export_l2},
+        {"momentary_active_import_l3", &p1_reader::P1Reader::set_sensor_momentary_active_import_l3},
+        {"momentary_active_export_l3", &p1_reader::P1Reader::set_sensor_momentary_active_export_l3},
+        {"momentary_reactive_import_l1", &p1_reader::P1Reader::set_sensor_momentary_reactive_import_l1},
+        {"momentary_reactive_export_l1", &p1_reader::P1Reader::set_sensor_momentary_reactive_export_l1},
+        {"momentary_reactive_import_l2", &p1_reader::P1Reader::set_sensor_momentary_reactive_import_l2},
+        {"momentary_reactive_export_l2", &p1_reader::P1Reader::set_sensor_momentary_reactive_export_l2},
+        {"momentary_reactive_import_l3", &p1_reader::P1Reader::set_sensor_momentary_reactive_import_l3},
+        {"momentary_reactive_export_l3", &p1_reader::P1Reader::set_sensor_momentary_reactive_export_l3},
+        {"voltage_l1", &p1_reader::P1Reader::set_sensor_voltage_l1},
+        {"voltage_l2", &p1_reader::P1Reader::set_sensor_voltage_l2},
+        {"voltage_l3", &p1_reader::P1Reader::set_sensor_voltage_l3},
+        {"current_l1", &p1_reader::P1Reader::set_sensor_current_l1},
+        {"current_l2", &p1_reader::P1Reader::set_sensor_current_l2},
+        {"current_l3", &p1_reader::P1Reader::set_sensor_current_l3},
+        {"tariff", &p1_reader::P1Reader::set_sensor_tariff},
+        {"power_failures", &p1_reader::P1Reader::set_sensor_power_failures},
+        {"long_power_failures", &p1_reader::P1Reader::set_sensor_long_power_failures},
+        {"voltage_sags_l1", &p1_reader::P1Reader::set_sensor_voltage_sags_l1},
+        {"voltage_sags_l2", &p1_reader::P1Reader::set_sensor_voltage_sags_l2},
+        {"voltage_sags_l3", &p1_reader::P1Reader::set_sensor_voltage_sags_l3},
+        {"voltage_swells_l1", &p1_reader::P1Reader::set_sensor_voltage_swells_l1},
+        {"voltage_swells_l2", &p1_reader::P1Reader::set_sensor_voltage_swells_l2},
+        {"voltage_swells_l3", &p1_reader::P1Reader::set_sensor_voltage_swells_l3},
+    };
+
+    struct NamedTextSensor
+    {
+        const char *name;
+        void (p1_reader::P1Reader::*setter)(text_sensor::TextSensor *);
+    };
+
+    const NamedTextSensor TEXT_SENSORS[] = {
+        {"timestamp", &p1_reader::P1Reader::set_text_sensor_timestamp},
+        {"equipment_id", &p1_reader::P1Reader::set_text_sensor_equipment_id},
+        {"dsmr_version", &p1_reader::P1Reader::set_text_sensor_dsmr_version},
+        {"message", &p1_reader::P1Reader::set_text_sensor_message},
+        {"mbus_1_timestamp", &p1_reader::P1Reader::set_text_sensor_mbus_1_timestamp},
+        {"mbus_2_timestamp", &p1_reader::P1Reader::set_text_sensor_mbus_2_timestamp},
+        {"mbus_3_timestamp", &p1_reader::P1Reader::set_text_sensor_mbus_3_timestamp},
+        {"mbus_4_timestamp", &p1_reader::P1Reader::set_text_sensor_mbus_4_timestamp},
+    };
+
+    const NamedSensor DIAGNOSTICS[] = {
+        {"telegrams_per_minute", &p1_reader::P1Reader::set_diagnostic_telegrams_per_minute},
+        {"crc_failures", &p1_reader::P1Reader::set_diagnostic_crc_failures},
+        {"frame_errors", &p1_reader::P1Reader::set_diagnostic_frame_errors},
+        {"max_update_time", &p1_reader::P1Reader::set_diagnostic_max_update_time},
+        {"publish_latency", &p1_reader::P1Reader::set_diagnostic_publish_latency},
+        {"uart_high_water", &p1_reader::P1Reader::set_diagnostic_uart_high_water},
+    };
+
+    // ASCII telegrams are stored one line per line; the wire format is CRLF
+    bool loadAscii(const std::string &path, std::vector<uint8_t> *out)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            out->insert(out->end(), line.begin(), line.end());
+            out->push_back('\r');
+            out->push_back('\n');
+        }
+        return !out->empty();
+    }
+
+    // HDLC frames are stored as whitespace separated hex bytes, '#' starts a comment
+    bool loadHex(const std::string &path, std::vector<uint8_t> *out)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+
+        std::string line;
+        while (std::getline(in, line))
+        {
+            line = line.substr(0, line.find('#'));
+            std::istringstream tokens(line);
+            std::string token;
+            while (tokens >> token)
+                out->push_back((uint8_t)strtoul(token.c_str(), nullptr, 16));
+        }
+        return !out->empty();
+    }
+
+    std::vector<std::string> splitList(const std::string &list)
+    {
+        std::vector<std::string> items;
+        std::istringstream in(list);
+        std::string item;
+        while (std::getline(in, item, ','))
+            items.push_back(item);
+        return items;
+    }
+
+    // One meter: its own UART, reader and sensors, and what its calls cost
+    struct Meter
+    {
+        std::string protocol;
+        std::string file;
+        std::vector<uint8_t> telegram;
+        uart::UARTComponent uart;
+        std::unique_ptr<BenchReader> reader;
+        std::vector<sensor::Sensor> sensors;
+        std::vector<sensor::Sensor> diagnostics;
+        std::vector<text_sensor::TextSensor> texts;
+
+        uint64_t totalNs{0};
+        uint64_t worstNs{0};
+        uint64_t latencyTotalUs{0};
+        uint64_t latencyWorstUs{0};
+    };
+
+    void usage(const char *argv0)
+    {
+        fprintf(stderr,
+                "usage: %s [options]\n"
+                "  --protocol P,P,...      parser to run per meter, ascii or hdlc (default %s)\n"
+                "  --file PATH,PATH,...    telegram to replay per meter (.txt for ascii, .hex for hdlc)\n"
+                "  --sensors A,B,...       only configure these sensors (default all)\n"
+                "  --deadband V|P%%        deadband for every sensor, absolute or percent\n"
+                "  --max-interval MS       max_interval for every sensor\n"
+                "  --read-mode polling|loop|task  drive update() from the poller or loop(), or\n"
+                "                          read in the reader task and publish from loop() (default polling)\n"
+                "  --loop-ms N             main loop interval in loop mode (default 16, 1 while\n"
+                "                          the reader asks for a high frequency loop)\n"
+                "  --time-budget MS        time_budget for one update() (default 20)\n"
+                "  --publish-cost-us N     simulated time each publish_state takes (default 0)\n"
+                "  --baud N                simulated baud rate (default 115200)\n"
+                "  --telegrams N           number of telegrams to replay (default 200)\n"
+                "  --interval-ms N         meter push interval (default 1000)\n"
+                "  --rx-buffer N           simulated uart rx_buffer_size (default 3072)\n"
+                "  --repeat                enable repeat_to_tx\n"
+                "  --buffer-size N         buffer_size of every meter (default 1024)\n"
+                "  --capture               enable capture_telegram (needs buffer_size >= telegram)\n"
+                "  --key HEX               decryption_key for ciphered hdlc messages\n"
+                "  --auth-key HEX          authentication_key for ciphered hdlc messages\n"
+                "  --values                print the last published sensor values\n"
+                "  --dump-trace            call dump_trace() at the end (build with TRACE=ring)\n"
+                "  --log N                 esphome log level to print (0-7, default 0)\n",
+                argv0, BENCH_DEFAULT_PROTOCOL);
+    }
+
+    bool parseArgs(int argc, char **argv, Options *opt)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--values")
+                opt->values = true;
+            else if (arg == "--repeat")
+                opt->repeat = true;
+            else if (arg == "--capture")
+                opt->capture = true;
+            else if (arg == "--dump-trace")
+                opt->dumpTrace = true;
+            else if (arg == "--protocol" && hasValue)
+                opt->protocols = splitList(argv[++i]);
+            else if (arg == "--file" && hasValue)
+                opt->files = splitList(argv[++i]);
+            else if (arg == "--buffer-size" && hasValue)
+                opt->bufferSize = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--key" && hasValue)
+                opt->decryptionKey = argv[++i];
+            else if (arg == "--auth-key" && hasValue)
+                opt->authenticationKey = argv[++i];
+            else if (arg == "--sensors" && hasValue)
+                opt->sensors = argv[++i];
+            else if (arg == "--deadband" && hasValue)
+                opt->deadband = argv[++i];
+            else if (arg == "--max-interval" && hasValue)
+                opt->maxIntervalMs = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--read-mode" && hasValue)
+                opt->readMode = argv[++i];
+            else if (arg == "--publish-cost-us" && hasValue)
+                opt->publishCostUs = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--time-budget" && hasValue)
+                opt->timeBudgetMs = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--loop-ms" && hasValue)
+                opt->loopMs = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--baud" && hasValue)
+                opt->baud = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--telegrams" && hasValue)
+                opt->telegrams = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--interval-ms" && hasValue)
+                opt->intervalMs = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--rx-buffer" && hasValue)
+                opt->rxBufferSize = strtoul(argv[++i], nullptr, 10);
+            else if (arg == "--log" && hasValue)
+                bench::logLevel = atoi(argv[++i]);
+            else
+                return false;
+        }
+        if (opt->protocols.empty())
+            opt->protocols.push_back(BENCH_DEFAULT_PROTOCOL);
+        for (const std::string &protocol : opt->protocols)
+        {
+            if (protocol != "ascii" && protocol != "hdlc")
+                return false;
+        }
+        return opt->files.size() <= opt->protocols.size() &&
+               (opt->readMode == "polling" || opt->readMode == "loop" || opt->readMode == "task");
+    }
+}
+
+bool setupMeter(const Options &opt, size_t index, Meter *meter)
+{
+    meter->protocol = opt.protocols[index];
+    bool ascii = meter->protocol == "ascii";
+    meter->file = index < opt.files.size() ? opt.files[index] : "";
+    if (meter->file.empty())
+        meter->file = std::string(BENCH_DATA_DIR) + (ascii ? "/ascii_sagemcom_t211.txt" : "/hdlc_aidon_6442se.hex");
+
+    if (!(ascii ? loadAscii(meter->file, &meter->telegram) : loadHex(meter->file, &meter->telegram)))
+    {
+        fprintf(stderr, "Could not read telegram from %s\n", meter->file.c_str());
+        return false;
+    }
+
+    meter->uart.set_baud_rate(opt.baud);
+    meter->uart.set_rx_buffer_size(opt.rxBufferSize);
+
+    meter->reader.reset(new BenchReader(&meter->uart));
+    BenchReader &reader = *meter->reader;
+    reader.set_protocol_type(meter->protocol);
+    reader.set_buffer_size(opt.bufferSize);
+    reader.set_repeat_to_tx(opt.repeat);
+    reader.set_capture_telegram(opt.capture);
+    reader.set_read_mode(opt.readMode);
+    reader.set_reader_task(opt.readMode == "task");
+    reader.set_time_budget(opt.timeBudgetMs);
+    if (!opt.decryptionKey.empty())
+        reader.set_decryption_key(opt.decryptionKey);
+    if (!opt.authenticationKey.empty())
+        reader.set_authentication_key(opt.authenticationKey);
+
+    meter->sensors.reserve(sizeof(SENSORS) / sizeof(SENSORS[0]));
+    for (const NamedSensor &named : SENSORS)
+    {
+        std::string list = "," + opt.sensors + ",";
+        if (!opt.sensors.empty() && list.find("," + std::string(named.name) + ",") == std::string::npos)
+            continue;
+
+        meter->sensors.emplace_back(named.name);
+        (reader.*named.setter)(&meter->sensors.back());
+    }
+
+    meter->texts.reserve(sizeof(TEXT_SENSORS) / sizeof(TEXT_SENSORS[0]));
+    for (const NamedTextSensor &named : TEXT_SENSORS)
+    {
+        std::string list = "," + opt.sensors + ",";
+        if (!opt.sensors.empty() && list.find("," + std::string(named.name) + ",") == std::string::npos)
+            continue;
+
+        meter->texts.emplace_back(named.name);
+        (reader.*named.setter)(&meter->texts.back());
+    }
+
+    meter->diagnostics.reserve(sizeof(DIAGNOSTICS) / sizeof(DIAGNOSTICS[0]));
+    for (const NamedSensor &named : DIAGNOSTICS)
+    {
+        meter->diagnostics.emplace_back(named.name);
+        (reader.*named.setter)(&meter->diagnostics.back());
+    }
+
+    if (!opt.deadband.empty() || opt.maxIntervalMs > 0)
+    {
+        // Same scaling as sensor.py: milli-units, or hundredths of a percent
+        bool percent = !opt.deadband.empty() && opt.deadband.back() == '%';
+        double amount = opt.deadband.empty() ? 0.0 : atof(opt.deadband.c_str());
+        int32_t scaled = (int32_t)(amount * (percent ? 100 : 1000) + 0.5);
+        for (uint8_t slot = 0; slot < p1_reader::SLOT_COUNT; slot++)
+            reader.set_publish_filter(slot, scaled, percent, opt.maxIntervalMs);
+    }
+
+    reader.call_setup();
+    return !reader.is_failed();
+}
+
+void report(const Options &opt, const Meter &meter, uint64_t calls, uint32_t callIntervalMs, const char *callName)
+{
+    const BenchReader &reader = *meter.reader;
+    uint32_t published = reader.telegramsPublished();
+    uint64_t publishCalls = 0;
+    for (const sensor::Sensor &s : meter.sensors)
+        publishCalls += s.publishCount;
+
+    double cpuSeconds = meter.totalNs / 1e9;
+    printf("protocol            %s (%s)\n", meter.protocol.c_str(), meter.file.c_str());
+    printf("telegram            %zu bytes, %u sent at %u baud every %u ms\n",
+           meter.telegram.size(), opt.telegrams, opt.baud, opt.intervalMs);
+    printf("uart                rx_buffer_size %zu, high water %zu, %llu bytes dropped, %llu echoed\n",
+           opt.rxBufferSize, meter.uart.highWater, (unsigned long long)meter.uart.bytesDropped,
+           (unsigned long long)meter.uart.bytesWritten);
+    printf("%-19s %llu calls every %u ms, mean %.1f us, worst %.1f us\n",
+           callName, (unsigned long long)calls, callIntervalMs,
+           calls ? meter.totalNs / 1e3 / calls : 0.0, meter.worstNs / 1e3);
+    printf("busy-wait           %.3f ms total\n", bench::busyWaitUs / 1e3);
+    printf("telegrams published %u of %u, %llu publish_state calls (%.1f per telegram)\n",
+           published, opt.telegrams, (unsigned long long)publishCalls,
+           published ? (double)publishCalls / published : 0.0);
+    printf("latency             mean %.1f ms, worst %.1f ms from end of telegram to publish\n",
+           published ? meter.latencyTotalUs / 1e3 / published : 0.0, meter.latencyWorstUs / 1e3);
+    printf("throughput          %.0f bytes/s, %.1f telegrams/s (cpu time %.3f ms)\n",
+           cpuSeconds > 0 ? meter.uart.bytesRead / cpuSeconds : 0.0,
+           cpuSeconds > 0 ? published / cpuSeconds : 0.0,
+           cpuSeconds * 1e3);
+
+    // The same without the busy-waits, i.e. what the parsing itself costs
+    double parseSeconds = cpuSeconds - bench::busyWaitUs / 1e6;
+    printf("  excl. busy-wait   %.0f bytes/s, %.1f telegrams/s (cpu time %.3f ms)\n",
+           parseSeconds > 0 ? meter.uart.bytesRead / parseSeconds : 0.0,
+           parseSeconds > 0 ? published / parseSeconds : 0.0,
+           parseSeconds * 1e3);
+
+    if (opt.values)
+    {
+        for (const sensor::Sensor &s : meter.sensors)
+            printf("  %-30s %12.3f (%u)\n", s.get_name().c_str(), s.state, s.publishCount);
+        for (const text_sensor::TextSensor &s : meter.texts)
+            printf("  %-30s %12s (%u)\n", s.get_name().c_str(), s.state.c_str(), s.publishCount);
+        printf("diagnostics (last of %u publishes)\n", meter.diagnostics.front().publishCount);
+        for (const sensor::Sensor &s : meter.diagnostics)
+            printf("  %-30s %12.3f\n", s.get_name().c_str(), s.state);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, &opt))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    sensor::Sensor::costUs = opt.publishCostUs;
+    bool taskMode = opt.readMode == "task";
+    bool loopMode = opt.readMode == "loop" || taskMode;
+
+    std::vector<std::unique_ptr<Meter>> meters;
+    uint32_t callIntervalMs = opt.loopMs;
+    for (size_t i = 0; i < opt.protocols.size(); i++)
+    {
+        meters.emplace_back(new Meter());
+        if (!setupMeter(opt, i, meters.back().get()))
+            return 1;
+        if (!loopMode && (i == 0 || meters.back()->reader->get_update_interval() < callIntervalMs))
+            callIntervalMs = meters.back()->reader->get_update_interval();
+    }
+
+    for (auto &meter : meters)
+        meter->uart.replay(meter->telegram, opt.telegrams, (uint64_t)opt.intervalMs * 1000);
+
+    uint64_t rounds = 0;
+    uint64_t worstRoundNs = 0;
+    uint32_t drainUpdates = 0;
+
+    // Keep calling update() (or loop()) of every meter until the replays are done and a
+    // few more calls have had the chance to publish the last telegrams, or for as long as
+    // a slow publish_state needs to get through the last one
+    uint64_t lastRoundUs = 0;
+    while (true)
+    {
+        bool replayDone = true;
+        bool publishing = false;
+        for (auto &meter : meters)
+        {
+            replayDone = replayDone && meter->uart.replayDone();
+            publishing = publishing || meter->reader->publishPending();
+        }
+        if (replayDone)
+            drainUpdates++;
+        if (drainUpdates >= (loopMode ? 100u : 10u) && (!publishing || drainUpdates >= 1000u))
+            break;
+
+        // Rounds are scheduled every interval from the start of the last one, a round that took
+        // longer is followed by the next straight away. ESPHome spins loop() without the
+        // usual delay while a component asks for it.
+        uint64_t intervalUs = (uint64_t)callIntervalMs * 1000;
+        if (loopMode && HighFrequencyLoopRequester::is_high_frequency())
+            intervalUs = 1000;
+        if (lastRoundUs < intervalUs)
+            bench::simOffsetUs += intervalUs - lastRoundUs;
+
+        uint64_t roundNs = 0;
+        for (auto &meter : meters)
+        {
+            BenchReader &reader = *meter->reader;
+            uint32_t publishedBefore = reader.telegramsPublished();
+            uint64_t busyBefore = bench::busyWaitUs;
+            uint64_t simulatedBefore = bench::simulatedUs;
+            auto start = std::chrono::steady_clock::now();
+            // loop() of every component, update() as long as the poller runs
+            if (taskMode)
+                reader.readerTaskStep();
+            reader.loop();
+            if (reader.poller_running())
+                reader.update();
+            auto end = std::chrono::steady_clock::now();
+            reader.run_intervals();
+
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() +
+                          (bench::busyWaitUs - busyBefore + bench::simulatedUs - simulatedBefore) * 1000;
+            meter->totalNs += ns;
+            meter->worstNs = std::max(meter->worstNs, ns);
+            roundNs += ns;
+
+            // Time from the last byte of the telegram on the wire to its values being published
+            if (reader.telegramsPublished() != publishedBefore)
+            {
+                uint64_t nowUs = bench::nowUs();
+                uint64_t endUs = meter->uart.telegramEndUs(reader.telegramsPublished() - 1);
+                uint64_t latencyUs = nowUs > endUs ? nowUs - endUs : 0;
+                meter->latencyTotalUs += latencyUs;
+                meter->latencyWorstUs = std::max(meter->latencyWorstUs, latencyUs);
+            }
+        }
+
+        worstRoundNs = std::max(worstRoundNs, roundNs);
+        lastRoundUs = roundNs / 1000;
+        rounds++;
+    }
+
+    if (opt.dumpTrace)
+    {
+        // The log level only matters for printing, the ring records regardless
+        bench::logLevel = std::max(bench::logLevel, ESPHOME_LOG_LEVEL_INFO);
+        meters.front()->reader->dump_trace();
+    }
+
+    bool allPublished = true;
+    uint64_t totalNs = 0;
+    for (size_t i = 0; i < meters.size(); i++)
+    {
+        if (meters.size() > 1)
+            printf("%smeter %zu\n", i ? "\n" : "", i + 1);
+        report(opt, *meters[i], rounds, callIntervalMs,
+               taskMode ? "task + loop()" : loopMode ? "loop()" : "update()");
+        allPublished = allPublished && meters[i]->reader->telegramsPublished() == opt.telegrams;
+        totalNs += meters[i]->totalNs;
+    }
+
+    if (meters.size() > 1)
+    {
+        printf("\nall meters          cpu time %.3f ms, %.3f ms per meter, worst round of calls %.1f us\n",
+               totalNs / 1e6, totalNs / 1e6 / meters.size(), worstRoundNs / 1e3);
+    }
+
+    return allPublished ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+// Host stand-in for esphome/components/sensor/sensor.h. Keeps the last state
+// and counts publishes so the bench can check what the parser produced.
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace sensor
+    {
+        class Sensor
+        {
+        public:
+            explicit Sensor(const std::string &name = "") : name_(name) {}
+
+            void publish_state(float state)
+            {
+                this->state = state;
+                publishCount++;
+
+                // What the filters, API and MQTT would cost on the device
+                bench::simOffsetUs += costUs;
+                bench::simulatedUs += costUs;
+            }
+
+            // Simulated time every publish_state takes (--publish-cost-us)
+            static uint32_t costUs;
+
+            const std::string &get_name() const { return name_; }
+
+            float state{0.0f};
+            uint32_t publishCount{0};
+
+        protected:
+            std::string name_;
+        };
+    }
+}
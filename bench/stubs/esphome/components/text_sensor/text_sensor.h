@@ -0,0 +1,37 @@
+// Host stand-in for esphome/components/text_sensor/text_sensor.h. Keeps the last
+// state and counts publishes, like the Sensor stand-in.
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace text_sensor
+    {
+        class TextSensor
+        {
+        public:
+            explicit TextSensor(const std::string &name = "") : name_(name) {}
+
+            void publish_state(const std::string &state)
+            {
+                this->state = state;
+                hasState_ = true;
+                publishCount++;
+            }
+
+            bool has_state() const { return hasState_; }
+            const std::string &get_name() const { return name_; }
+
+            std::string state;
+            uint32_t publishCount{0};
+
+        protected:
+            std::string name_;
+            bool hasState_{false};
+        };
+    }
+}
@@ -0,0 +1,97 @@
+// Host stand-in for esphome/components/uart/uart.h.
+//
+// UARTComponent replays a byte stream as if it came off the wire at the
+// configured baud rate: byte n of the stream "arrives" n byte-times after the
+// replay started (plus the gap between telegrams), and lands in an RX FIFO of
+// rx_buffer_size bytes. Bytes arriving while the FIFO is full are dropped and
+// counted, the same way the real driver loses them.
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace uart
+    {
+        enum UARTParityOptions
+        {
+            UART_CONFIG_PARITY_NONE,
+            UART_CONFIG_PARITY_EVEN,
+            UART_CONFIG_PARITY_ODD,
+        };
+
+        class UARTComponent
+        {
+        public:
+            void set_baud_rate(uint32_t baud_rate) { baud_rate_ = baud_rate; }
+            uint32_t get_baud_rate() const { return baud_rate_; }
+            void set_rx_buffer_size(size_t rx_buffer_size) { rx_buffer_size_ = rx_buffer_size; }
+            size_t get_rx_buffer_size() { return rx_buffer_size_; }
+            uint8_t get_data_bits() const { return 8; }
+            uint8_t get_stop_bits() const { return 1; }
+            UARTParityOptions get_parity() const { return UART_CONFIG_PARITY_NONE; }
+
+            // Replay `telegram` `count` times, starting a new copy every
+            // `interval_us` (or back to back if the telegram is longer).
+            void replay(const std::vector<uint8_t> &telegram, uint32_t count, uint64_t interval_us);
+            bool replayDone() const { return nextTelegram_ >= telegramCount_ && fifo_.empty(); }
+            // When the last byte of telegram n is on the wire
+            uint64_t telegramEndUs(uint32_t n) const;
+
+            int available();
+            bool read_byte(uint8_t *data);
+            bool peek_byte(uint8_t *data);
+            bool read_array(uint8_t *data, size_t len);
+            void write_array(const uint8_t * /* data */, size_t len) { bytesWritten += len; }
+            void write_byte(uint8_t data) { write_array(&data, 1); }
+            void flush() {}
+
+            uint64_t byteTimeUs() const;
+
+            uint64_t bytesReceived{0};
+            uint64_t bytesDropped{0};
+            uint64_t bytesRead{0};
+            uint64_t bytesWritten{0};
+            size_t highWater{0};
+
+        protected:
+            void pump();
+            uint64_t periodUs() const;
+
+            uint32_t baud_rate_{115200};
+            size_t rx_buffer_size_{256};
+
+            std::vector<uint8_t> telegram_;
+            uint32_t telegramCount_{0};
+            uint64_t intervalUs_{0};
+            uint64_t startUs_{0};
+            uint32_t nextTelegram_{0};
+            size_t nextByte_{0};
+            std::deque<uint8_t> fifo_;
+        };
+
+        class UARTDevice
+        {
+        public:
+            UARTDevice() = default;
+            UARTDevice(UARTComponent *parent) : parent_(parent) {}
+
+            void set_uart_parent(UARTComponent *parent) { parent_ = parent; }
+
+            int available() { return parent_->available(); }
+            bool read_byte(uint8_t *data) { return parent_->read_byte(data); }
+            bool peek_byte(uint8_t *data) { return parent_->peek_byte(data); }
+            bool read_array(uint8_t *data, size_t len) { return parent_->read_array(data, len); }
+            void write_byte(uint8_t data) { parent_->write_byte(data); }
+            void write_array(const uint8_t *data, size_t len) { parent_->write_array(data, len); }
+            void flush() { parent_->flush(); }
+
+        protected:
+            UARTComponent *parent_{nullptr};
+        };
+    }
+}
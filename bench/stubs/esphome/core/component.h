@@ -0,0 +1,98 @@
+// Host stand-in for esphome/core/component.h, just enough of Component and
+// PollingComponent for the p1reader component to compile and be driven by
+// the bench.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome
+{
+    namespace setup_priority
+    {
+        const float BUS = 1000.0f;
+        const float IO = 900.0f;
+        const float HARDWARE = 800.0f;
+        const float DATA = 600.0f;
+        const float PROCESSOR = 400.0f;
+        const float AFTER_WIFI = 200.0f;
+        const float LATE = -100.0f;
+    }
+
+    const uint32_t SCHEDULER_DONT_RUN = 4294967295UL;
+
+    class Component
+    {
+    public:
+        virtual ~Component() = default;
+        virtual void setup() {}
+        virtual void loop() {}
+        virtual void dump_config() {}
+        virtual float get_setup_priority() const { return setup_priority::DATA; }
+
+        void mark_failed() { failed_ = true; }
+        bool is_failed() const { return failed_; }
+
+        // Bench only: runs the set_interval() callbacks that are due, the scheduler does
+        // this on the device
+        void run_intervals()
+        {
+            for (Interval &interval : intervals_)
+            {
+                if (millis() - interval.lastMs >= interval.intervalMs)
+                {
+                    interval.lastMs = millis();
+                    interval.callback();
+                }
+            }
+        }
+
+    protected:
+        struct Interval
+        {
+            uint32_t intervalMs;
+            uint32_t lastMs;
+            std::function<void()> callback;
+        };
+
+        void set_interval(const std::string & /* name */, uint32_t interval, std::function<void()> &&f)
+        {
+            intervals_.push_back({interval, millis(), std::move(f)});
+        }
+
+        bool failed_{false};
+        std::vector<Interval> intervals_;
+    };
+
+    class PollingComponent : public Component
+    {
+    public:
+        explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+
+        virtual void update() = 0;
+        virtual void set_update_interval(uint32_t update_interval) { update_interval_ = update_interval; }
+        uint32_t get_update_interval() const { return update_interval_; }
+
+        // Like ESPHome, the poller is started before setup(), which may stop or restart it
+        void call_setup()
+        {
+            start_poller();
+            setup();
+        }
+
+        void start_poller() { poller_running_ = update_interval_ != SCHEDULER_DONT_RUN; }
+        void stop_poller() { poller_running_ = false; }
+
+        // Bench only: whether the scheduler would be calling update()
+        bool poller_running() const { return poller_running_; }
+
+    protected:
+        uint32_t update_interval_;
+        bool poller_running_{false};
+    };
+}
@@ -0,0 +1,38 @@
+// Host stand-ins for the Arduino/ESPHome HAL used by the p1reader component.
+//
+// Time is simulated: millis()/micros() follow the real clock, but the bench
+// can push the clock forward (idle time between update() calls) and
+// delayMicroseconds() only advances the clock instead of sleeping, so a
+// busy-wait costs no wall time but is still accounted for as CPU time.
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+typedef uint8_t byte;
+
+#define PROGMEM
+
+namespace esphome
+{
+    namespace bench
+    {
+        // Simulated time added on top of the real monotonic clock
+        extern uint64_t simOffsetUs;
+        // Total time "spent" in delayMicroseconds()
+        extern uint64_t busyWaitUs;
+        // Total time other simulated work took (see Sensor::costUs)
+        extern uint64_t simulatedUs;
+
+        uint64_t nowUs();
+    }
+
+    inline uint8_t progmem_read_byte(const uint8_t *addr) { return *addr; }
+    inline uint16_t progmem_read_uint16(const uint16_t *addr) { return *addr; }
+}
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
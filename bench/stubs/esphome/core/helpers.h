@@ -0,0 +1,34 @@
+// Host stand-in for esphome/core/helpers.h, only HighFrequencyLoopRequester.
+// The bench shortens its simulated loop interval while a request is active.
+#pragma once
+
+#include <cstdint>
+
+namespace esphome
+{
+    class HighFrequencyLoopRequester
+    {
+    public:
+        void start()
+        {
+            if (started_)
+                return;
+            numRequests++;
+            started_ = true;
+        }
+
+        void stop()
+        {
+            if (!started_)
+                return;
+            numRequests--;
+            started_ = false;
+        }
+
+        static bool is_high_frequency() { return numRequests > 0; }
+
+    protected:
+        bool started_{false};
+        static uint32_t numRequests;
+    };
+}
@@ -0,0 +1,34 @@
+// Host stand-in for esphome/core/log.h. Messages at or below
+// bench::logLevel are printed to stderr, everything else is dropped.
+#pragma once
+
+#include <cstdarg>
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#define ESPHOME_LOG_LEVEL_VERY_VERBOSE 7
+
+namespace esphome
+{
+    namespace bench
+    {
+        extern int logLevel;
+        void log(int level, const char *tag, int line, const char *format, ...) __attribute__((format(printf, 4, 5)));
+    }
+}
+
+#define ESP_LOG_AT(level, tag, format, ...) \
+    do { if ((level) <= esphome::bench::logLevel) esphome::bench::log(level, tag, __LINE__, format, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_AT(ESPHOME_LOG_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_AT(ESPHOME_LOG_LEVEL_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_AT(ESPHOME_LOG_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGCONFIG(tag, format, ...) ESP_LOG_AT(ESPHOME_LOG_LEVEL_CONFIG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_AT(ESPHOME_LOG_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_AT(ESPHOME_LOG_LEVEL_VERBOSE, tag, format, ##__VA_ARGS__)
+#define ESP_LOGVV(tag, format, ...) ESP_LOG_AT(ESPHOME_LOG_LEVEL_VERY_VERBOSE, tag, format, ##__VA_ARGS__)
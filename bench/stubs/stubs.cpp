@@ -0,0 +1,166 @@
+// Implementation of the host stand-ins declared under stubs/esphome.
+#include <chrono>
+#include <cstdio>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/uart/uart.h"
+
+namespace esphome
+{
+    uint32_t HighFrequencyLoopRequester::numRequests = 0;
+    uint32_t sensor::Sensor::costUs = 0;
+
+    namespace bench
+    {
+        uint64_t simOffsetUs = 0;
+        uint64_t busyWaitUs = 0;
+        uint64_t simulatedUs = 0;
+        int logLevel = ESPHOME_LOG_LEVEL_NONE;
+
+        uint64_t nowUs()
+        {
+            static const auto epoch = std::chrono::steady_clock::now();
+            auto real = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - epoch).count();
+            return (uint64_t)real + simOffsetUs;
+        }
+
+        void log(int level, const char *tag, int line, const char *format, ...)
+        {
+            static const char LEVELS[] = "-EWICDVV";
+            fprintf(stderr, "[%c][%s:%d]: ", LEVELS[level], tag, line);
+            va_list args;
+            va_start(args, format);
+            vfprintf(stderr, format, args);
+            va_end(args);
+            fputc('\n', stderr);
+        }
+    }
+
+    namespace uart
+    {
+        uint64_t UARTComponent::byteTimeUs() const
+        {
+            // 8N1: start + 8 data + stop
+            return (10ull * 1000000ull) / baud_rate_;
+        }
+
+        void UARTComponent::replay(const std::vector<uint8_t> &telegram, uint32_t count, uint64_t interval_us)
+        {
+            telegram_ = telegram;
+            telegramCount_ = count;
+            intervalUs_ = interval_us;
+            startUs_ = bench::nowUs();
+            nextTelegram_ = 0;
+            nextByte_ = 0;
+            fifo_.clear();
+        }
+
+        uint64_t UARTComponent::periodUs() const
+        {
+            uint64_t telegramUs = byteTimeUs() * telegram_.size();
+            return intervalUs_ > telegramUs ? intervalUs_ : telegramUs;
+        }
+
+        uint64_t UARTComponent::telegramEndUs(uint32_t n) const
+        {
+            return startUs_ + n * periodUs() + telegram_.size() * byteTimeUs();
+        }
+
+        void UARTComponent::pump()
+        {
+            if (telegram_.empty())
+                return;
+
+            uint64_t now = bench::nowUs();
+            uint64_t byteUs = byteTimeUs();
+            uint64_t period = periodUs();
+
+            while (nextTelegram_ < telegramCount_)
+            {
+                uint64_t arrival = startUs_ + nextTelegram_ * period + (nextByte_ + 1) * byteUs;
+                if (arrival > now)
+                    break;
+
+                if (fifo_.size() < rx_buffer_size_)
+                    fifo_.push_back(telegram_[nextByte_]);
+                else
+                    bytesDropped++;
+                bytesReceived++;
+
+                if (++nextByte_ == telegram_.size())
+                {
+                    nextByte_ = 0;
+                    nextTelegram_++;
+                }
+            }
+
+            if (fifo_.size() > highWater)
+                highWater = fifo_.size();
+        }
+
+        int UARTComponent::available()
+        {
+            pump();
+            return (int)fifo_.size();
+        }
+
+        bool UARTComponent::read_byte(uint8_t *data)
+        {
+            pump();
+            if (fifo_.empty())
+                return false;
+            *data = fifo_.front();
+            fifo_.pop_front();
+            bytesRead++;
+            return true;
+        }
+
+        bool UARTComponent::peek_byte(uint8_t *data)
+        {
+            pump();
+            if (fifo_.empty())
+                return false;
+            *data = fifo_.front();
+            return true;
+        }
+
+        bool UARTComponent::read_array(uint8_t *data, size_t len)
+        {
+            pump();
+            if (fifo_.size() < len)
+                return false;
+            for (size_t i = 0; i < len; i++)
+            {
+                data[i] = fifo_.front();
+                fifo_.pop_front();
+            }
+            bytesRead += len;
+            return true;
+        }
+    }
+}
+
+uint32_t millis()
+{
+    return (uint32_t)(esphome::bench::nowUs() / 1000);
+}
+
+uint32_t micros()
+{
+    return (uint32_t)esphome::bench::nowUs();
+}
+
+void delay(uint32_t ms)
+{
+    delayMicroseconds(ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    esphome::bench::simOffsetUs += us;
+    esphome::bench::busyWaitUs += us;
+}
@@ -1,21 +1,93 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome.components import uart
 from esphome.const import (
     CONF_UART_ID, CONF_ID
 )
+from esphome.core import CORE
 
 CODEOWNERS = ["cadwal"]
 
 MULTI_CONF = True
 
 DEPENDENCIES = ["uart"]
-AUTO_LOAD = ["sensor"]
+AUTO_LOAD = ["sensor", "text_sensor"]
 
 CONF_P1READER_ID = "p1reader_id"
 CONF_BUFFER_SIZE = "buffer_size"
 CONF_PROTOCOL = "protocol"
 CONF_REPEAT_TO_TX = "repeat_to_tx"
+CONF_CRC_TABLE = "crc_table"
+CONF_READ_MODE = "read_mode"
+CONF_TIME_BUDGET = "time_budget"
+CONF_CAPTURE_TELEGRAM = "capture_telegram"
+CONF_READER_TASK = "reader_task"
+CONF_TRACE = "trace"
+CONF_DECRYPTION_KEY = "decryption_key"
+CONF_AUTHENTICATION_KEY = "authentication_key"
+
+# What the parser trace points compile to, see trace.h
+TRACE_MODES = {
+    "log": "P1READER_TRACE_LOG",
+    "none": "P1READER_TRACE_NONE",
+    "ring": "P1READER_TRACE_RING",
+}
+
+# Entries per CRC lookup table, see crc16.h
+CRC_TABLES = {
+    "bitwise": 0,
+    "nibble": 16,
+    "byte": 256,
+    "slice_by_4": 1024,
+}
+
+
+def _validate_capture_telegram(config):
+    capture = config[CONF_CAPTURE_TELEGRAM]
+    if capture and config[CONF_PROTOCOL] != "ascii":
+        raise cv.Invalid(f"{CONF_CAPTURE_TELEGRAM} only applies to protocol ascii")
+    # A captured telegram has to fit in the buffer as a whole, a line is enough otherwise
+    if CONF_BUFFER_SIZE not in config:
+        config[CONF_BUFFER_SIZE] = 1024 if capture else 60
+    return config
+
+
+def _validate_key(value):
+    # AES-128 key as given by the grid operator, 32 hex digits
+    value = cv.string_strict(value).replace(" ", "")
+    if len(value) != 32:
+        raise cv.Invalid("Key has to be 32 hex digits (16 bytes)")
+    try:
+        bytes.fromhex(value)
+    except ValueError as err:
+        raise cv.Invalid("Key has to be 32 hex digits (16 bytes)") from err
+    return value
+
+
+def _validate_keys(config):
+    if CONF_DECRYPTION_KEY in config and config[CONF_PROTOCOL] != "hdlc":
+        raise cv.Invalid(f"{CONF_DECRYPTION_KEY} only applies to protocol hdlc")
+    if CONF_AUTHENTICATION_KEY in config and CONF_DECRYPTION_KEY not in config:
+        raise cv.Invalid(f"{CONF_AUTHENTICATION_KEY} needs a {CONF_DECRYPTION_KEY}")
+    return config
+
+
+def _validate_reader_task(config):
+    if config[CONF_READER_TASK] and not CORE.is_esp32:
+        raise cv.Invalid(f"{CONF_READER_TASK} needs an ESP32")
+    return config
+
+
+def _final_validate_shared(config):
+    # The CRC kernel and the trace points are compiled once and shared by every reader
+    for key in (CONF_CRC_TABLE, CONF_TRACE):
+        if len({conf[key] for conf in fv.full_config.get()["p1reader"]}) > 1:
+            raise cv.Invalid(f"{key} has to be the same for every p1reader")
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate_shared
 
 p1reader_ns = cg.esphome_ns.namespace("esphome::p1_reader")
 P1Reader = p1reader_ns.class_("P1Reader", cg.PollingComponent, uart.UARTDevice)
@@ -24,11 +96,26 @@ CONFIG_SCHEMA = cv.All(
     cv.Schema(
         {
             cv.GenerateID(): cv.declare_id(P1Reader),
-            cv.Optional(CONF_BUFFER_SIZE, default=60): cv.positive_not_null_int,
+            cv.Optional(CONF_BUFFER_SIZE): cv.int_range(min=1, max=8192),
             cv.Optional(CONF_PROTOCOL, default="ascii"): cv.one_of("ascii", "hdlc", lower=True),
             cv.Optional(CONF_REPEAT_TO_TX, default=False): cv.boolean,
+            cv.Optional(CONF_CAPTURE_TELEGRAM, default=False): cv.boolean,
+            cv.Optional(CONF_READ_MODE, default="polling"): cv.one_of("polling", "loop", lower=True),
+            cv.Optional(CONF_READER_TASK, default=False): cv.boolean,
+            # ESPHome warns about components blocking for more than 30 ms
+            cv.Optional(CONF_TIME_BUDGET, default="20ms"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(milliseconds=1), max=cv.TimePeriod(milliseconds=30)),
+            ),
+            cv.Optional(CONF_CRC_TABLE, default="byte"): cv.one_of(*CRC_TABLES, lower=True),
+            cv.Optional(CONF_TRACE, default="log"): cv.one_of(*TRACE_MODES, lower=True),
+            cv.Optional(CONF_DECRYPTION_KEY): _validate_key,
+            cv.Optional(CONF_AUTHENTICATION_KEY): _validate_key,
         }
     ).extend(cv.COMPONENT_SCHEMA).extend(uart.UART_DEVICE_SCHEMA),
+    _validate_capture_telegram,
+    _validate_reader_task,
+    _validate_keys,
     cv.only_with_arduino,
 )
 
@@ -39,8 +126,15 @@ async def to_code(config):
     await cg.register_component(var, config)
 
     cg.add(var.set_protocol_type(config[CONF_PROTOCOL]))
+    cg.add(var.set_buffer_size(config[CONF_BUFFER_SIZE]))
     cg.add(var.set_repeat_to_tx(config[CONF_REPEAT_TO_TX]))
-    if config[CONF_PROTOCOL] == "ascii":
-        cg.add_define("BUF_SIZE", config[CONF_BUFFER_SIZE])
-    else:
-        cg.add_define("BUF_SIZE", 4096)
+    cg.add(var.set_capture_telegram(config[CONF_CAPTURE_TELEGRAM]))
+    cg.add(var.set_read_mode(config[CONF_READ_MODE]))
+    cg.add(var.set_reader_task(config[CONF_READER_TASK]))
+    cg.add(var.set_time_budget(config[CONF_TIME_BUDGET].total_milliseconds))
+    if CONF_DECRYPTION_KEY in config:
+        cg.add(var.set_decryption_key(config[CONF_DECRYPTION_KEY]))
+    if CONF_AUTHENTICATION_KEY in config:
+        cg.add(var.set_authentication_key(config[CONF_AUTHENTICATION_KEY]))
+    cg.add_define("P1READER_CRC_TABLE", CRC_TABLES[config[CONF_CRC_TABLE]])
+    cg.add_define(TRACE_MODES[config[CONF_TRACE]])
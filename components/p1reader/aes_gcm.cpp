@@ -0,0 +1,231 @@
+#include <cstring>
+
+#include "aes_gcm.h"
+#include "esphome/core/hal.h"
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        namespace
+        {
+#ifndef USE_ESP32
+            const uint8_t SBOX[256] PROGMEM = {
+                0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+                0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+                0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+                0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+                0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+                0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+                0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+                0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+                0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+                0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+                0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+                0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+                0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+                0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+                0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+                0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+            };
+
+            inline uint8_t sbox(uint8_t b)
+            {
+                return progmem_read_byte(SBOX + b);
+            }
+
+            inline uint8_t xtime(uint8_t b)
+            {
+                return (uint8_t) ((b << 1) ^ ((b & 0x80) ? 0x1b : 0));
+            }
+#endif
+
+            void xorBlock(uint8_t *to, const uint8_t *from)
+            {
+                for (uint8_t i = 0; i < GcmDecryptor::BLOCK_LEN; i++)
+                    to[i] ^= from[i];
+            }
+        }
+
+        GcmDecryptor::GcmDecryptor()
+        {
+#ifdef USE_ESP32
+            mbedtls_aes_init(&_aes);
+#endif
+        }
+
+        GcmDecryptor::~GcmDecryptor()
+        {
+#ifdef USE_ESP32
+            mbedtls_aes_free(&_aes);
+#endif
+        }
+
+        void GcmDecryptor::setKey(const uint8_t key[KEY_LEN])
+        {
+#ifdef USE_ESP32
+            mbedtls_aes_setkey_enc(&_aes, key, KEY_LEN * 8);
+#else
+            // AES-128 key expansion, four words per round key
+            memcpy(_roundKeys, key, KEY_LEN);
+            uint8_t rcon = 0x01;
+            for (uint8_t i = KEY_LEN; i < sizeof(_roundKeys); i += 4)
+            {
+                uint8_t word[4];
+                memcpy(word, _roundKeys + i - 4, 4);
+                if (i % KEY_LEN == 0)
+                {
+                    uint8_t first = word[0];
+                    word[0] = sbox(word[1]) ^ rcon;
+                    word[1] = sbox(word[2]);
+                    word[2] = sbox(word[3]);
+                    word[3] = sbox(first);
+                    rcon = xtime(rcon);
+                }
+                for (uint8_t j = 0; j < 4; j++)
+                    _roundKeys[i + j] = _roundKeys[i + j - KEY_LEN] ^ word[j];
+            }
+#endif
+
+            uint8_t zero[BLOCK_LEN] = {0};
+            encryptBlock(zero, _h);
+        }
+
+        void GcmDecryptor::encryptBlock(const uint8_t in[BLOCK_LEN], uint8_t out[BLOCK_LEN])
+        {
+#ifdef USE_ESP32
+            mbedtls_aes_crypt_ecb(&_aes, MBEDTLS_AES_ENCRYPT, in, out);
+#else
+            uint8_t s[BLOCK_LEN];
+            memcpy(s, in, BLOCK_LEN);
+            xorBlock(s, _roundKeys);
+
+            for (uint8_t round = 1; round <= 10; round++)
+            {
+                // SubBytes and ShiftRows in one go, the state is column major
+                uint8_t t[BLOCK_LEN];
+                for (uint8_t col = 0; col < 4; col++)
+                    for (uint8_t row = 0; row < 4; row++)
+                        t[col * 4 + row] = sbox(s[((col + row) % 4) * 4 + row]);
+
+                if (round < 10)
+                {
+                    // MixColumns
+                    for (uint8_t col = 0; col < 4; col++)
+                    {
+                        uint8_t *c = t + col * 4;
+                        uint8_t all = c[0] ^ c[1] ^ c[2] ^ c[3];
+                        uint8_t first = c[0];
+                        c[0] ^= all ^ xtime(c[0] ^ c[1]);
+                        c[1] ^= all ^ xtime(c[1] ^ c[2]);
+                        c[2] ^= all ^ xtime(c[2] ^ c[3]);
+                        c[3] ^= all ^ xtime(c[3] ^ first);
+                    }
+                }
+
+                xorBlock(t, _roundKeys + round * BLOCK_LEN);
+                memcpy(s, t, BLOCK_LEN);
+            }
+            memcpy(out, s, BLOCK_LEN);
+#endif
+        }
+
+        void GcmDecryptor::start(const uint8_t iv[IV_LEN], const uint8_t *aad, size_t aadLen)
+        {
+            // 96 bit IV: J0 = IV | 0x00000001, the first block of text uses J0 + 1
+            memcpy(_j0, iv, IV_LEN);
+            _j0[12] = 0;
+            _j0[13] = 0;
+            _j0[14] = 0;
+            _j0[15] = 1;
+            memcpy(_counter, _j0, BLOCK_LEN);
+
+            memset(_ghash, 0, BLOCK_LEN);
+            for (size_t pos = 0; pos < aadLen; pos += BLOCK_LEN)
+            {
+                uint8_t block[BLOCK_LEN] = {0};
+                memcpy(block, aad + pos, aadLen - pos < BLOCK_LEN ? aadLen - pos : BLOCK_LEN);
+                ghashBlock(block);
+            }
+
+            _aadLen = aadLen;
+            _textLen = 0;
+            _pos = BLOCK_LEN;
+        }
+
+        void GcmDecryptor::nextKeyStream()
+        {
+            // inc32, only the last 32 bits count
+            for (uint8_t i = BLOCK_LEN - 1; i >= 12; i--)
+            {
+                if (++_counter[i] != 0)
+                    break;
+            }
+            encryptBlock(_counter, _keyStream);
+            _pos = 0;
+        }
+
+        uint8_t GcmDecryptor::decrypt(uint8_t c)
+        {
+            if (_pos == BLOCK_LEN)
+                nextKeyStream();
+
+            _cipherBlock[_pos] = c;
+            uint8_t p = c ^ _keyStream[_pos];
+            _textLen++;
+            if (++_pos == BLOCK_LEN)
+                ghashBlock(_cipherBlock);
+            return p;
+        }
+
+        void GcmDecryptor::finish(uint8_t tag[BLOCK_LEN])
+        {
+            // The last block of cipher text, zero padded
+            if (_pos < BLOCK_LEN)
+            {
+                memset(_cipherBlock + _pos, 0, BLOCK_LEN - _pos);
+                ghashBlock(_cipherBlock);
+                _pos = BLOCK_LEN;
+            }
+
+            // Lengths in bits, 64 bits each
+            uint8_t lengths[BLOCK_LEN] = {0};
+            uint64_t aadBits = (uint64_t) _aadLen * 8;
+            uint64_t textBits = (uint64_t) _textLen * 8;
+            for (uint8_t i = 0; i < 8; i++)
+            {
+                lengths[7 - i] = (uint8_t) (aadBits >> (8 * i));
+                lengths[15 - i] = (uint8_t) (textBits >> (8 * i));
+            }
+            ghashBlock(lengths);
+
+            encryptBlock(_j0, tag);
+            xorBlock(tag, _ghash);
+        }
+
+        void GcmDecryptor::ghashBlock(const uint8_t block[BLOCK_LEN])
+        {
+            // _ghash = (_ghash ^ block) * H in GF(2^128), bit by bit. GCM numbers the bits
+            // from the top of the first byte, so shifting right is multiplying by x.
+            uint8_t x[BLOCK_LEN];
+            uint8_t v[BLOCK_LEN];
+            memcpy(x, _ghash, BLOCK_LEN);
+            xorBlock(x, block);
+            memcpy(v, _h, BLOCK_LEN);
+            memset(_ghash, 0, BLOCK_LEN);
+
+            for (uint8_t i = 0; i < 128; i++)
+            {
+                if (x[i / 8] & (0x80 >> (i % 8)))
+                    xorBlock(_ghash, v);
+
+                bool carry = v[BLOCK_LEN - 1] & 1;
+                for (uint8_t j = BLOCK_LEN - 1; j > 0; j--)
+                    v[j] = (uint8_t) ((v[j] >> 1) | (v[j - 1] << 7));
+                v[0] >>= 1;
+                if (carry)
+                    v[0] ^= 0xe1;
+            }
+        }
+    }
+}
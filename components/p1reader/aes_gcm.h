@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef USE_ESP32
+#include <mbedtls/aes.h>
+#endif
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        /*  AES-128-GCM, decryption only, one byte at a time so it can follow the HDLC
+            decoder through a frame as it comes in. A block of key stream is made every 16
+            bytes and GHASH is folded in as each block completes, nothing else is held.
+
+            The block cipher is mbedTLS on ESP32, which ESP-IDF runs on the AES hardware,
+            and a small software AES elsewhere, with the S-box as its only table (in flash).
+            GHASH is software on both.
+        */
+        class GcmDecryptor
+        {
+        public:
+            static const uint8_t KEY_LEN = 16;
+            static const uint8_t IV_LEN = 12;
+            static const uint8_t BLOCK_LEN = 16;
+
+            GcmDecryptor();
+            ~GcmDecryptor();
+
+            void setKey(const uint8_t key[KEY_LEN]);
+
+            // Starts a message, aad is authenticated but not encrypted
+            void start(const uint8_t iv[IV_LEN], const uint8_t *aad, size_t aadLen);
+
+            // Next byte of cipher text in, plain text out
+            uint8_t decrypt(uint8_t c);
+
+            // Authentication tag over what was decrypted since start(), meters send the
+            // first 12 bytes
+            void finish(uint8_t tag[BLOCK_LEN]);
+
+        protected:
+            void encryptBlock(const uint8_t in[BLOCK_LEN], uint8_t out[BLOCK_LEN]);
+            void nextKeyStream();
+            void ghashBlock(const uint8_t block[BLOCK_LEN]);
+
+#ifdef USE_ESP32
+            mbedtls_aes_context _aes;
+#else
+            uint8_t _roundKeys[11 * BLOCK_LEN];
+#endif
+            uint8_t _h[BLOCK_LEN];          // E(K, 0), the GHASH key
+            uint8_t _j0[BLOCK_LEN];         // IV | 1, the tag is masked with E(K, J0)
+            uint8_t _counter[BLOCK_LEN];
+            uint8_t _keyStream[BLOCK_LEN];
+            uint8_t _ghash[BLOCK_LEN];
+            uint8_t _cipherBlock[BLOCK_LEN]; // cipher text of the block in progress
+            uint8_t _pos{BLOCK_LEN};         // next byte of _keyStream
+            uint32_t _aadLen{0};
+            uint32_t _textLen{0};
+        };
+    }
+}
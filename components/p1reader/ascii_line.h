@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        // A piece of a line, as offset and length into the line buffer
+        struct Token
+        {
+            uint16_t offset;
+            uint16_t length;
+
+            const char* in(const char* line) const { return line + offset; }
+        };
+
+        // One "1-0:1.8.0(00006678.394*kWh)" data line split into its parts, without
+        // copying anything or writing terminators into the line. Lines with more than one
+        // (...), such as "0-1:24.2.1(230101120000W)(00123.456*m3)", have their value and
+        // unit taken from the last one.
+        struct AsciiLine
+        {
+            Token dataId;   // 1-0
+            Token obisCode; // 1.8.0
+            Token value;    // 00006678.394
+            Token unit;     // kWh, empty when the value has no unit
+            Token first;    // everything in the first (...), the timestamp of an M-Bus reading
+
+            // Splits line in a single pass. Returns false for lines without data
+            // (the header, the empty line after it and the CRC line). A truncated line, cut off
+            // by the end of the buffer, has the group it ends in taken up to the end.
+            static bool tokenize(const char* line, size_t len, AsciiLine* out, bool truncated = false)
+            {
+                size_t i = 0;
+                size_t start = 0;
+
+                while (i < len && line[i] != ':' && line[i] != '(')
+                    i++;
+                if (i == len || line[i] != ':')
+                    return false;
+                out->dataId = {(uint16_t) start, (uint16_t) (i - start)};
+
+                start = ++i;
+                while (i < len && line[i] != '(')
+                    i++;
+                if (i == len)
+                    return false;
+                out->obisCode = {(uint16_t) start, (uint16_t) (i - start)};
+
+                // line[i] is the '(' of the first group
+                bool firstGroup = true;
+                do
+                {
+                    start = ++i;
+                    while (i < len && line[i] != '*' && line[i] != ')')
+                        i++;
+                    if (i == len && !truncated)
+                        return false;
+                    out->value = {(uint16_t) start, (uint16_t) (i - start)};
+                    if (i == len)
+                    {
+                        out->unit = {(uint16_t) i, 0};
+                        if (firstGroup)
+                            out->first = out->value;
+                        return true;
+                    }
+
+                    if (line[i] == '*')
+                    {
+                        size_t unitStart = ++i;
+                        while (i < len && line[i] != ')')
+                            i++;
+                        if (i == len)
+                            return false;
+                        out->unit = {(uint16_t) unitStart, (uint16_t) (i - unitStart)};
+                    }
+                    else
+                    {
+                        out->unit = {(uint16_t) i, 0};
+                    }
+
+                    if (firstGroup)
+                    {
+                        out->first = {(uint16_t) start, (uint16_t) (i - start)};
+                        firstGroup = false;
+                    }
+                    i++; // past the ')'
+                } while (i < len && line[i] == '(');
+
+                return true;
+            }
+        };
+    }
+}
@@ -0,0 +1,127 @@
+#include "crc16.h"
+#include "esphome/core/hal.h"
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        namespace
+        {
+            struct NibbleTable
+            {
+                uint16_t entry[16];
+            };
+
+            struct ByteTable
+            {
+                uint16_t entry[256];
+            };
+
+            struct Slice4Table
+            {
+                uint16_t entry[4][256];
+            };
+
+            constexpr uint16_t crcOfBits(uint16_t poly, uint16_t crc, int bits)
+            {
+                for (int i = 0; i < bits; i++)
+                    crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+                return crc;
+            }
+
+            constexpr NibbleTable makeNibbleTable(uint16_t poly)
+            {
+                NibbleTable table{};
+                for (int i = 0; i < 16; i++)
+                    table.entry[i] = crcOfBits(poly, i, 4);
+                return table;
+            }
+
+            constexpr ByteTable makeByteTable(uint16_t poly)
+            {
+                ByteTable table{};
+                for (int i = 0; i < 256; i++)
+                    table.entry[i] = crcOfBits(poly, i, 8);
+                return table;
+            }
+
+            // entry[k][i] is the CRC of byte i followed by k zero bytes
+            constexpr Slice4Table makeSlice4Table(uint16_t poly)
+            {
+                Slice4Table table{};
+                for (int i = 0; i < 256; i++)
+                    table.entry[0][i] = crcOfBits(poly, i, 8);
+                for (int k = 1; k < 4; k++)
+                    for (int i = 0; i < 256; i++)
+                        table.entry[k][i] = (table.entry[k - 1][i] >> 8) ^ table.entry[0][table.entry[k - 1][i] & 0xff];
+                return table;
+            }
+
+            // Only what a build actually calls is linked, the rest is dropped by --gc-sections
+            constexpr NibbleTable ARC_NIBBLE PROGMEM = makeNibbleTable(CRC16_ARC);
+            constexpr NibbleTable X25_NIBBLE PROGMEM = makeNibbleTable(CRC16_X25);
+            constexpr ByteTable ARC_BYTE PROGMEM = makeByteTable(CRC16_ARC);
+            constexpr ByteTable X25_BYTE PROGMEM = makeByteTable(CRC16_X25);
+            constexpr Slice4Table ARC_SLICE4 PROGMEM = makeSlice4Table(CRC16_ARC);
+            constexpr Slice4Table X25_SLICE4 PROGMEM = makeSlice4Table(CRC16_X25);
+
+            inline uint16_t lookup(const uint16_t *table, uint8_t index)
+            {
+                return progmem_read_uint16(table + index);
+            }
+        }
+
+        uint16_t crc16Bitwise(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                crc ^= data[i];
+                for (int k = 0; k < 8; k++)
+                    crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+            }
+            return crc;
+        }
+
+        uint16_t crc16Nibble(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len)
+        {
+            const uint16_t *table = poly == CRC16_ARC ? ARC_NIBBLE.entry : X25_NIBBLE.entry;
+            for (size_t i = 0; i < len; i++)
+            {
+                crc ^= data[i];
+                crc = (crc >> 4) ^ lookup(table, crc & 0x0f);
+                crc = (crc >> 4) ^ lookup(table, crc & 0x0f);
+            }
+            return crc;
+        }
+
+        uint16_t crc16Byte(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len)
+        {
+            const uint16_t *table = poly == CRC16_ARC ? ARC_BYTE.entry : X25_BYTE.entry;
+            for (size_t i = 0; i < len; i++)
+                crc = (crc >> 8) ^ lookup(table, (crc ^ data[i]) & 0xff);
+            return crc;
+        }
+
+        uint16_t crc16Slice4(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len)
+        {
+            const Slice4Table &table = poly == CRC16_ARC ? ARC_SLICE4 : X25_SLICE4;
+
+            // Four bytes per round: the two bytes that overlap the CRC register are looked up
+            // three and two bytes "ahead", the other two as is, and the results are combined
+            while (len >= 4)
+            {
+                uint8_t b0 = (crc ^ data[0]) & 0xff;
+                uint8_t b1 = ((crc >> 8) ^ data[1]) & 0xff;
+                crc = lookup(table.entry[3], b0) ^ lookup(table.entry[2], b1) ^
+                      lookup(table.entry[1], data[2]) ^ lookup(table.entry[0], data[3]);
+                data += 4;
+                len -= 4;
+            }
+
+            while (len--)
+                crc = (crc >> 8) ^ lookup(table.entry[0], (crc ^ *data++) & 0xff);
+
+            return crc;
+        }
+    }
+}
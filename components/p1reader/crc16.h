@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Kernel used by crc16Update(), set with crc_table in YAML:
+//   0 = bit loop, 16 = nibble table, 256 = byte table, 1024 = slice-by-4
+#ifndef P1READER_CRC_TABLE
+#define P1READER_CRC_TABLE 256
+#endif
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        // Both CRCs used by P1 are reflected CRC-16s, so only the polynomial differs
+        const uint16_t CRC16_ARC = 0xA001; // ASCII telegram "!XXXX" (poly 0x8005, init 0)
+        const uint16_t CRC16_X25 = 0x8408; // HDLC HCS/FCS (poly 0x1021, init/xorout 0xffff)
+
+        // The individual kernels, all giving the same result. The table based ones
+        // only have tables for CRC16_ARC and CRC16_X25, the tables live in flash.
+        uint16_t crc16Bitwise(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len);
+        uint16_t crc16Nibble(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len);   // 2 x 32 bytes of tables
+        uint16_t crc16Byte(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len);     // 2 x 512 bytes of tables
+        uint16_t crc16Slice4(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len);   // 2 x 2 KB of tables
+
+        // Folds data into crc using the kernel selected by P1READER_CRC_TABLE
+        inline uint16_t crc16Update(uint16_t poly, uint16_t crc, const uint8_t *data, size_t len)
+        {
+#if P1READER_CRC_TABLE == 0
+            return crc16Bitwise(poly, crc, data, len);
+#elif P1READER_CRC_TABLE == 16
+            return crc16Nibble(poly, crc, data, len);
+#elif P1READER_CRC_TABLE == 1024
+            return crc16Slice4(poly, crc, data, len);
+#else
+            return crc16Byte(poly, crc, data, len);
+#endif
+        }
+    }
+}
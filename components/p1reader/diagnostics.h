@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        // Counters for the diagnostic sensors, cheap enough to keep on the hot path.
+        //
+        // The first group is written by whatever reads the meter (the reader task on ESP32)
+        // and only read when publishing. Those never reset, each has a single writer and
+        // rates come from the difference between two publishes, so no read-modify-write
+        // ever crosses tasks. The second group belongs to the main loop and starts over
+        // after every publish.
+        struct Diagnostics
+        {
+            std::atomic<uint32_t> telegrams{0};      // passed their CRC
+            std::atomic<uint32_t> crcFailures{0};    // CRC (or HDLC header/frame check) failed
+            std::atomic<uint32_t> frameErrors{0};    // HDLC frames dropped for length or structure
+            std::atomic<uint32_t> uartHighWater{0};  // most bytes ever waiting in the UART
+
+            uint32_t maxCallUs{0};     // longest update() (or publishing loop()) since the last publish
+            uint32_t maxLatencyMs{0};  // longest time from reading a telegram to its last value published
+
+            // State of the last publish, for the rates
+            uint32_t lastTelegrams{0};
+            uint32_t lastPublishMs{0};
+
+            static void count(std::atomic<uint32_t> &counter)
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+
+            void noteAvailable(uint32_t avail)
+            {
+                if (avail > uartHighWater.load(std::memory_order_relaxed))
+                    uartHighWater.store(avail, std::memory_order_relaxed);
+            }
+
+            void noteCall(uint32_t us)
+            {
+                if (us > maxCallUs)
+                    maxCallUs = us;
+            }
+
+            void noteLatency(uint32_t ms)
+            {
+                if (ms > maxLatencyMs)
+                    maxLatencyMs = ms;
+            }
+        };
+    }
+}
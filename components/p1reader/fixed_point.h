@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        enum NumberResult : uint8_t
+        {
+            NUMBER_OK,
+            NUMBER_EMPTY,     // nothing but an optional sign
+            NUMBER_INVALID,   // anything but [-]digits[.digits]
+            NUMBER_OVERFLOW,  // more integer digits than MAX_INTEGER_DIGITS
+        };
+
+        // Integer digits of a value, leading zeros not counted. 15 keeps the milli-units
+        // well inside 64 bits, the spec goes to 99999999.999.
+        static const uint8_t MAX_INTEGER_DIGITS = 15;
+        static const uint64_t INTEGER_LIMIT = 1000000000000000ULL;  // 10^MAX_INTEGER_DIGITS
+
+        inline const char* numberResultText(NumberResult result)
+        {
+            switch (result)
+            {
+                case NUMBER_OK: return "ok";
+                case NUMBER_EMPTY: return "empty";
+                case NUMBER_INVALID: return "not a number";
+                case NUMBER_OVERFLOW: return "too large";
+            }
+            return "?";
+        }
+
+        // Parses "[-]digits[.digits]" of exactly len characters into milli-units, "1.5" -> 1500,
+        // "-00230" -> -230000. Decimals past the third are checked but dropped (the spec has
+        // no more than 3). Never reads past len and leaves milli alone on anything but NUMBER_OK.
+        inline NumberResult parseMilli(const char* text, size_t len, int64_t* milli)
+        {
+            size_t i = 0;
+            bool negative = len > 0 && text[0] == '-';
+            i += negative;
+
+            // Digits are told apart with one unsigned compare, anything below '0' wraps.
+            // Leading zeros keep intPart at 0, so they don't count towards the bound.
+            size_t intStart = i;
+            uint64_t intPart = 0;
+            for (; i < len; i++)
+            {
+                uint8_t d = (uint8_t) (text[i] - '0');
+                if (d > 9)
+                    break;
+                intPart = intPart * 10 + d;
+                if (intPart >= INTEGER_LIMIT)
+                    return NUMBER_OVERFLOW;
+            }
+            size_t intDigits = i - intStart;
+
+            // Scale the (up to 3) decimals to milli-units: "3" -> 300, "45" -> 450, "678" -> 678,
+            // anything after that only has to be digits
+            uint32_t decPart = 0;
+            size_t decDigits = 0;
+            if (i < len && text[i] == '.')
+            {
+                size_t decStart = ++i;
+                uint32_t decFactor = 100;
+                for (; i < len; i++)
+                {
+                    uint8_t d = (uint8_t) (text[i] - '0');
+                    if (d > 9)
+                        break;
+                    decPart += d * decFactor;
+                    decFactor /= 10;
+                }
+                decDigits = i - decStart;
+            }
+
+            if (intDigits == 0 && decDigits == 0)
+                return len == (size_t) negative ? NUMBER_EMPTY : NUMBER_INVALID;
+            if (i != len)
+                return NUMBER_INVALID;
+
+            int64_t value = (int64_t) (intPart * 1000 + decPart);
+            *milli = negative ? -value : value;
+            return NUMBER_OK;
+        }
+    }
+}
@@ -0,0 +1,784 @@
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#include "hdlc_decoder.h"
+#include "trace.h"
+#include "esphome/core/log.h"
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        namespace
+        {
+            // How the contents of an A-XDR type are delimited (Blue Book / IEC 62056-6-2)
+            enum TypeKind : uint8_t
+            {
+                TYPE_UNKNOWN,        // no way to tell where it ends
+                TYPE_FIXED,          // size bytes
+                TYPE_OCTETS,         // length prefix in bytes
+                TYPE_BITS,           // length prefix in bits
+                TYPE_ELEMENTS,       // length prefix in elements (array, structure)
+                TYPE_COMPACT_ARRAY,  // type description, then a length prefix in bytes
+            };
+
+            const uint8_t TYPE_INTEGER = 0x01;
+            const uint8_t TYPE_SIGNED = 0x02;
+            const uint8_t TYPE_FLOAT = 0x04;
+
+            struct AxdrType
+            {
+                uint8_t kind;
+                uint8_t size;
+                uint8_t flags;
+            };
+
+            // Indexed by tag, everything past the end is unknown except dont-care (0xff)
+            const AxdrType AXDR_TYPES[] = {
+                {TYPE_FIXED, 0, 0},                            // 0x00 null-data
+                {TYPE_ELEMENTS, 0, 0},                         // 0x01 array
+                {TYPE_ELEMENTS, 0, 0},                         // 0x02 structure
+                {TYPE_FIXED, 1, 0},                            // 0x03 boolean
+                {TYPE_BITS, 0, 0},                             // 0x04 bit-string
+                {TYPE_FIXED, 4, TYPE_INTEGER | TYPE_SIGNED},   // 0x05 double-long
+                {TYPE_FIXED, 4, TYPE_INTEGER},                 // 0x06 double-long-unsigned
+                {TYPE_UNKNOWN, 0, 0},                          // 0x07
+                {TYPE_UNKNOWN, 0, 0},                          // 0x08
+                {TYPE_OCTETS, 0, 0},                           // 0x09 octet-string
+                {TYPE_OCTETS, 0, 0},                           // 0x0a visible-string
+                {TYPE_UNKNOWN, 0, 0},                          // 0x0b
+                {TYPE_OCTETS, 0, 0},                           // 0x0c utf8-string
+                {TYPE_FIXED, 1, 0},                            // 0x0d bcd
+                {TYPE_UNKNOWN, 0, 0},                          // 0x0e
+                {TYPE_FIXED, 1, TYPE_INTEGER | TYPE_SIGNED},   // 0x0f integer
+                {TYPE_FIXED, 2, TYPE_INTEGER | TYPE_SIGNED},   // 0x10 long
+                {TYPE_FIXED, 1, TYPE_INTEGER},                 // 0x11 unsigned
+                {TYPE_FIXED, 2, TYPE_INTEGER},                 // 0x12 long-unsigned
+                {TYPE_COMPACT_ARRAY, 0, 0},                    // 0x13 compact-array
+                {TYPE_FIXED, 8, TYPE_INTEGER | TYPE_SIGNED},   // 0x14 long64
+                {TYPE_FIXED, 8, TYPE_INTEGER},                 // 0x15 long64-unsigned
+                {TYPE_FIXED, 1, 0},                            // 0x16 enum
+                {TYPE_FIXED, 4, TYPE_FLOAT},                   // 0x17 float32
+                {TYPE_FIXED, 8, TYPE_FLOAT},                   // 0x18 float64
+                {TYPE_FIXED, 12, 0},                           // 0x19 date-time
+                {TYPE_FIXED, 5, 0},                            // 0x1a date
+                {TYPE_FIXED, 4, 0},                            // 0x1b time
+            };
+
+            const AxdrType DONT_CARE = {TYPE_FIXED, 0, 0};
+            const AxdrType UNKNOWN_TYPE = {TYPE_UNKNOWN, 0, 0};
+
+            const AxdrType &axdrType(uint8_t tag)
+            {
+                if (tag < sizeof(AXDR_TYPES) / sizeof(AXDR_TYPES[0]))
+                    return AXDR_TYPES[tag];
+                return tag == 0xff ? DONT_CARE : UNKNOWN_TYPE;
+            }
+
+            // Scale of a register without a scaler/unit in a flat code/value list. Kamstrup
+            // lists never have one: power in W, energy in 10 Wh, currents in 10 mA, voltages in V.
+            int8_t kamstrupScale(uint8_t slot)
+            {
+                if (slot < SLOT_MBUS_1_READING)
+                    return -2;  // kWh
+                if (slot >= SLOT_MOMENTARY_ACTIVE_IMPORT && slot <= SLOT_MOMENTARY_REACTIVE_EXPORT_L3)
+                    return -3;  // kW
+                if (slot >= SLOT_CURRENT_L1 && slot <= SLOT_CURRENT_L3)
+                    return -2;  // A
+                return 0;
+            }
+        }
+
+        HdlcDecoder::Result HdlcDecoder::feed(const uint8_t *data, size_t len, SlotMask wanted, size_t *consumed)
+        {
+            _wanted = wanted;
+
+            // Start of the bytes not folded into _crc yet, while inside the part the FCS covers
+            size_t crcFrom = 0;
+            size_t i = 0;
+            Result result = NEED_MORE;
+
+            while (i < len && result == NEED_MORE)
+            {
+                uint8_t b = data[i++];
+                switch (_state)
+                {
+                    case HUNT:
+                        if (b == FLAG)
+                            _state = FORMAT_HI;
+                        break;
+
+                    case FORMAT_HI:
+                        if (b == FLAG)
+                            break; // back to back flags
+
+                        // Type 3 frame (0xA), with the segmentation bit (0x08) set when the
+                        // message goes on in the next frame
+                        if ((b & 0xf0) != 0xa0)
+                        {
+                            result = dropFrame("Unsupported frame format");
+                            break;
+                        }
+
+                        startFrame((b & 0x08) != 0);
+                        crcFrom = i - 1;
+                        _remaining = (b & 0x07) << 8;
+                        _state = FORMAT_LO;
+                        break;
+
+                    case FORMAT_LO:
+                        // The length counts everything between the flags. Past the format there
+                        // must at least be two addresses, control, HCS, some information and FCS.
+                        _remaining |= b;
+                        if (_remaining < 2 + 1 + 1 + 1 + 2 + 1 + 2)
+                        {
+                            result = dropFrame("Frame too small");
+                            break;
+                        }
+                        _remaining -= 2;
+                        _addressLen = 0;
+                        _state = DEST_ADDR;
+                        break;
+
+                    case DEST_ADDR:
+                    case SRC_ADDR:
+                        // Addresses are 1, 2 or 4 bytes, the last one has bit 0 set
+                        _remaining--;
+                        if (++_addressLen > MAX_ADDRESS_LEN)
+                        {
+                            result = dropFrame("Address too long");
+                            break;
+                        }
+                        if (b & 0x01)
+                        {
+                            _addressLen = 0;
+                            _state = _state == DEST_ADDR ? SRC_ADDR : CONTROL;
+                        }
+                        break;
+
+                    case CONTROL:
+                        _remaining--;
+                        // HCS, at least one byte of information and FCS must follow
+                        if (_remaining < 2 + 1 + 2)
+                        {
+                            result = dropFrame("Frame too small");
+                            break;
+                        }
+                        _crc = crc16Update(CRC16_X25, _crc, data + crcFrom, i - crcFrom);
+                        crcFrom = i;
+                        _checkCrc = ~_crc;
+                        _state = HCS_LO;
+                        break;
+
+                    case HCS_LO:
+                        _remaining--;
+                        _received = b;
+                        _state = HCS_HI;
+                        break;
+
+                    case HCS_HI:
+                        _remaining--;
+                        if (((b << 8) | _received) != _checkCrc)
+                        {
+                            result = dropFrame("Header crc not matching", CRC_ERROR);
+                            break;
+                        }
+                        _state = INFO;
+                        break;
+
+                    case INFO:
+                        _remaining--;
+                        if (++_messageLen > MAX_MESSAGE_LEN)
+                        {
+                            result = dropFrame("Message too long");
+                            break;
+                        }
+                        apduByte(b);
+                        if (_remaining == 2)
+                        {
+                            _crc = crc16Update(CRC16_X25, _crc, data + crcFrom, i - crcFrom);
+                            _checkCrc = ~_crc;
+                            _state = FCS_LO;
+                        }
+                        break;
+
+                    case FCS_LO:
+                        _remaining--;
+                        _received = b;
+                        _state = FCS_HI;
+                        break;
+
+                    case FCS_HI:
+                        _remaining--;
+                        if (((b << 8) | _received) != _checkCrc)
+                        {
+                            ESP_LOGE("hdlc", "Frame crc (%04x) not matching calculated crc (%04x)",
+                                    (b << 8) | _received, _checkCrc);
+                            result = dropFrame("Frame crc not matching", CRC_ERROR);
+                            break;
+                        }
+                        _fcs = _checkCrc;
+                        _state = CLOSING_FLAG;
+                        break;
+
+                    case CLOSING_FLAG:
+                        if (b != FLAG)
+                            result = dropFrame("Closing flag missing");
+                        else if (_apdu == APDU_FAILED)
+                            result = dropFrame("Could not decode the message");
+                        else if (_segment)
+                            _continuing = true; // the message goes on in the next frame
+                        else if ((_apdu != BODY_DONE && _apdu != BODY_SKIPPED) ||
+                                 (_cipher != CIPHER_NONE && _cipher != CIPHER_DONE))
+                            result = dropFrame("Message ended early");
+                        else
+                            result = FRAME_OK;
+
+                        // The closing flag may be the opening flag of the next frame too
+                        _state = FORMAT_HI;
+                        break;
+                }
+
+                // A frame cut short may be followed straight away by the next one
+                if ((result == FRAME_ERROR || result == CRC_ERROR) && b == FLAG)
+                    _state = FORMAT_HI;
+            }
+
+            if (result == NEED_MORE && _state >= FORMAT_LO && _state <= INFO)
+                _crc = crc16Update(CRC16_X25, _crc, data + crcFrom, i - crcFrom);
+
+            *consumed = i;
+            return result;
+        }
+
+        void HdlcDecoder::commit(ParsedMessage *message) const
+        {
+            SlotMask pending = _staging.sensorsToSend;
+            while (pending != 0)
+            {
+                uint8_t slot = lowestSlot(pending);
+                pending &= ~slotBit(slot);
+                message->setValue(slot, _staging.getMilli(slot));
+            }
+        }
+
+        void HdlcDecoder::startFrame(bool segment)
+        {
+            _crc = 0xffff;
+            _segment = segment;
+
+            // The frames after the first of a segmented message carry on with its APDU where
+            // the last one stopped, without an LLC of their own
+            if (_continuing)
+            {
+                _continuing = false;
+                return;
+            }
+
+            _messageLen = 0;
+            _cipher = CIPHER_NONE;
+            _apdu = LLC;
+            _need = 3;
+            _depth = 0;
+            _flatList = false;
+            resetRegister();
+            _staging.sensorsToSend = 0;
+        }
+
+        HdlcDecoder::Result HdlcDecoder::dropFrame(const char *reason, Result result)
+        {
+            ESP_LOGE("hdlc", "%s, skipping to next frame.", reason);
+            _state = HUNT;
+            _continuing = false;
+            return result;
+        }
+
+        bool HdlcDecoder::setKeys(const uint8_t *decryptionKey, const uint8_t *authenticationKey)
+        {
+            if (_gcm == nullptr)
+                _gcm = new (std::nothrow) GcmDecryptor();
+            if (_gcm == nullptr)
+                return false;
+
+            _gcm->setKey(decryptionKey);
+            _authenticate = authenticationKey != nullptr;
+            if (_authenticate)
+                memcpy(_authKey, authenticationKey, GcmDecryptor::KEY_LEN);
+            return true;
+        }
+
+        void HdlcDecoder::apduByte(uint8_t b)
+        {
+            switch (_cipher)
+            {
+                case CIPHER_NONE:
+                    plainByte(b);
+                    break;
+
+                case CIPHER_TITLE_LEN:
+                    if (b != TITLE_LEN)
+                    {
+                        cipherFailed("Unsupported system title length", b);
+                        break;
+                    }
+                    _cipherPos = 0;
+                    _cipher = CIPHER_TITLE;
+                    break;
+
+                case CIPHER_TITLE:
+                    _iv[_cipherPos++] = b;
+                    if (_cipherPos == TITLE_LEN)
+                        _cipher = CIPHER_LEN;
+                    break;
+
+                case CIPHER_LEN:
+                    if (b < 0x80)
+                    {
+                        _cipherLeft = b;
+                        _cipher = CIPHER_SECURITY;
+                    }
+                    else if (b == 0x81 || b == 0x82)
+                    {
+                        _cipherPos = b & 0x7f;
+                        _cipherLeft = 0;
+                        _cipher = CIPHER_LEN_EXT;
+                    }
+                    else
+                    {
+                        cipherFailed("Unsupported length encoding", b);
+                    }
+                    break;
+
+                case CIPHER_LEN_EXT:
+                    _cipherLeft = (_cipherLeft << 8) | b;
+                    if (--_cipherPos == 0)
+                        _cipher = CIPHER_SECURITY;
+                    break;
+
+                case CIPHER_SECURITY:
+                    // Suite 0 (AES-GCM-128) with encryption (0x20), optionally authenticated
+                    // (0x10), no compression (0x80)
+                    if ((b & 0x20) == 0 || (b & 0x8f) != 0)
+                    {
+                        cipherFailed("Unsupported security control", b);
+                        break;
+                    }
+                    if (_cipherLeft < 1 + 4 + ((b & 0x10) ? TAG_LEN : 0))
+                    {
+                        cipherFailed("Ciphered content too short", b);
+                        break;
+                    }
+                    _security = b;
+                    _cipherLeft--;
+                    _cipherPos = TITLE_LEN;
+                    _cipher = CIPHER_COUNTER;
+                    break;
+
+                case CIPHER_COUNTER:
+                    _iv[_cipherPos++] = b;
+                    _cipherLeft--;
+                    if (_cipherPos == GcmDecryptor::IV_LEN)
+                    {
+                        // The tag covers security control | authentication key
+                        uint8_t aad[1 + GcmDecryptor::KEY_LEN];
+                        aad[0] = _security;
+                        if (_authenticate)
+                            memcpy(aad + 1, _authKey, GcmDecryptor::KEY_LEN);
+                        _gcm->start(_iv, aad, _authenticate ? sizeof(aad) : 0);
+
+                        if (_security & 0x10)
+                            _cipherLeft -= TAG_LEN;
+                        _cipherPos = 0;
+                        _cipher = _cipherLeft > 0 ? CIPHER_TEXT : (_security & 0x10) ? CIPHER_TAG : CIPHER_DONE;
+                    }
+                    break;
+
+                case CIPHER_TEXT:
+                    plainByte(_gcm->decrypt(b));
+                    if (--_cipherLeft == 0)
+                        _cipher = (_security & 0x10) ? CIPHER_TAG : CIPHER_DONE;
+                    break;
+
+                case CIPHER_TAG:
+                    _tagReceived[_cipherPos++] = b;
+                    if (_cipherPos < TAG_LEN)
+                        break;
+
+                    _cipher = CIPHER_DONE;
+                    if (_authenticate)
+                    {
+                        uint8_t tag[GcmDecryptor::BLOCK_LEN];
+                        _gcm->finish(tag);
+                        uint8_t diff = 0;
+                        for (uint8_t i = 0; i < TAG_LEN; i++)
+                            diff |= tag[i] ^ _tagReceived[i];
+                        if (diff != 0)
+                        {
+                            ESP_LOGE("hdlc", "Authentication tag not matching, wrong authentication_key?");
+                            _apdu = APDU_FAILED;
+                        }
+                    }
+                    break;
+
+                case CIPHER_DONE:
+                    break; // whatever is left until the FCS
+            }
+        }
+
+        void HdlcDecoder::cipherFailed(const char *reason, uint8_t b)
+        {
+            ESP_LOGE("hdlc", "%s (%x) in ciphered message", reason, b);
+            _cipher = CIPHER_DONE;
+            _apdu = APDU_FAILED;
+        }
+
+        void HdlcDecoder::plainByte(uint8_t b)
+        {
+            switch (_apdu)
+            {
+                case LLC:
+                    // E6 E7 00, nothing in there we need
+                    if (--_need == 0)
+                        _apdu = APDU_TAG;
+                    break;
+
+                case APDU_TAG:
+                    if ((b == 0xdb || b == 0xdc) && _cipher == CIPHER_NONE)
+                    {
+                        // general-glo-ciphering or general-ded-ciphering, the plain text
+                        // starts with an APDU tag again
+                        if (_gcm == nullptr)
+                        {
+                            ESP_LOGE("hdlc", "Ciphered message (%x), but no decryption_key set", b);
+                            _apdu = APDU_FAILED;
+                            break;
+                        }
+                        _cipher = CIPHER_TITLE_LEN;
+                        break;
+                    }
+                    if (b != 0x0f)
+                    {
+                        ESP_LOGE("hdlc", "Unsupported message (%x), expected data-notification (0x0f)", b);
+                        _apdu = APDU_FAILED;
+                        break;
+                    }
+                    _need = 4;
+                    _apdu = INVOKE_ID;
+                    break;
+
+                case INVOKE_ID:
+                    if (--_need == 0)
+                        _apdu = DATETIME_LEN;
+                    break;
+
+                case DATETIME_LEN:
+                    // Skip date field (normally 0, or 12 bytes). Some meters tag it as an octet
+                    // string, 9 is no valid length so it can only be that tag.
+                    if (b == 0x09)
+                        break;
+                    _need = b;
+                    _apdu = b > 0 ? DATETIME : DATA_TAG;
+                    break;
+
+                case DATETIME:
+                    if (--_need == 0)
+                        _apdu = DATA_TAG;
+                    break;
+
+                case DATA_TAG:
+                    dataTag(b);
+                    break;
+
+                case DATA_LEN:
+                    if (b < 0x80)
+                    {
+                        dataLength(b);
+                    }
+                    else if (b == 0x81 || b == 0x82)
+                    {
+                        _need = b & 0x7f;
+                        _have = 0;
+                        _apdu = DATA_LEN_EXT;
+                    }
+                    else
+                    {
+                        skipRestOfBody("Unsupported length encoding", b);
+                    }
+                    break;
+
+                case COMPACT_TYPE:
+                    // Only compact arrays of a simple type are skipped, a type description
+                    // of arrays or structures has a layout of its own
+                    if (axdrType(b).kind == TYPE_ELEMENTS || axdrType(b).kind == TYPE_COMPACT_ARRAY)
+                    {
+                        skipRestOfBody("Unsupported compact array", b);
+                        break;
+                    }
+                    _apdu = DATA_LEN;
+                    break;
+
+                case DATA_LEN_EXT:
+                    _have = (_have << 8) | b;
+                    if (--_need == 0)
+                        dataLength(_have);
+                    break;
+
+                case DATA_PAYLOAD:
+                    if (_have < SCRATCH_LEN)
+                        _scratch[_have] = b;
+                    if (++_have == _need)
+                        valueDone();
+                    break;
+
+                case BODY_DONE:
+                case BODY_SKIPPED:
+                case APDU_FAILED:
+                    break; // whatever is left until the FCS
+            }
+        }
+
+        void HdlcDecoder::dataTag(uint8_t tag)
+        {
+            _tag = tag;
+            const AxdrType &type = axdrType(tag);
+            switch (type.kind)
+            {
+                case TYPE_FIXED:
+                    _need = type.size;
+                    _have = 0;
+                    if (type.size == 0)
+                        valueDone();
+                    else
+                        _apdu = DATA_PAYLOAD;
+                    return;
+
+                case TYPE_OCTETS:
+                case TYPE_BITS:
+                case TYPE_ELEMENTS:
+                    _apdu = DATA_LEN;
+                    return;
+
+                case TYPE_COMPACT_ARRAY:
+                    _apdu = COMPACT_TYPE;
+                    return;
+
+                default:
+                    // Nothing tells how long it is, so nothing after it can be found
+                    skipRestOfBody("Unknown tag", tag);
+                    return;
+            }
+        }
+
+        void HdlcDecoder::skipRestOfBody(const char *reason, uint8_t b)
+        {
+            ESP_LOGW("hdlc", "%s (%x), skipping the rest of the message.", reason, b);
+            resetRegister();
+            _apdu = BODY_SKIPPED;
+        }
+
+        void HdlcDecoder::dataLength(uint16_t len)
+        {
+            _apdu = DATA_TAG;
+
+            uint8_t kind = axdrType(_tag).kind;
+            if (kind == TYPE_BITS)
+            {
+                len = (len + 7) / 8;
+            }
+            else if (kind == TYPE_ELEMENTS)
+            {
+                if (len == 0)
+                {
+                    elementDone();
+                }
+                else if (_depth == MAX_DEPTH)
+                {
+                    skipRestOfBody("Message nested too deep", _depth);
+                }
+                else
+                {
+                    _left[_depth++] = len;
+                }
+                return;
+            }
+
+            _need = len;
+            _have = 0;
+            if (len == 0)
+                valueDone();
+            else
+                _apdu = DATA_PAYLOAD;
+        }
+
+        void HdlcDecoder::valueDone()
+        {
+            _apdu = DATA_TAG;
+
+            // Scaler and unit come in a structure of their own inside the register
+            bool inScalerUnit = _obis != OBIS_INVALID && _depth > _obisDepth;
+
+            const AxdrType &type = axdrType(_tag);
+
+            if (_tag == 0x09 && _need == 6)
+            {
+                // Registers listed as plain code/value pairs (Kamstrup) have no structure of
+                // their own to end them, the next code does
+                if (_obis != OBIS_INVALID && _depth == _obisDepth)
+                    _flatList = true;
+                if (_hasValue && _depth == _obisDepth)
+                    emitRegister();
+                resetRegister();
+
+                // Some meters count electricity from channel 1 (1-1:1.7.0), the tables use 1-0
+                uint8_t channel = _scratch[0] == 1 && _scratch[1] == 1 ? 0 : _scratch[1];
+                _obis = obisKey(_scratch[0], channel, _scratch[2], _scratch[3], _scratch[4]);
+                _obisDepth = _depth;
+            }
+            else if (inScalerUnit && _tag == 0x0f)
+            {
+                _scale = (int8_t) _scratch[0]; // 10E(scale)
+                _hasScaler = true;
+            }
+            else if (inScalerUnit && _tag == 0x16)
+            {
+                // Unit
+                // 0x1b: (k)W
+                // 0x1d: (k)VAr
+                // 0x1e: (k)Wh
+                // 0x20: (k)VArh
+                // 0x21: A
+                // 0x23: V
+                uint8_t unit = _scratch[0];
+                if (_scale == 0 && unit != 0x21 && unit != 0x23)
+                    _scale = -3; // ref KILO in sensor.py
+            }
+            else if (type.flags & TYPE_INTEGER)
+            {
+                // Big endian, sign extended from the top byte for the signed types
+                uint64_t raw = (type.flags & TYPE_SIGNED) && (_scratch[0] & 0x80) ? ~(uint64_t) 0 : 0;
+                for (uint16_t j = 0; j < _need; j++)
+                    raw = (raw << 8) | _scratch[j];
+                _value = (int64_t) raw;
+                _valueMilli = false;
+                _hasValue = true;
+            }
+            else if (type.flags & TYPE_FLOAT)
+            {
+                // IEEE 754, big endian. Kept in milli-units straight away, the fraction would
+                // be lost otherwise.
+                uint64_t raw = 0;
+                for (uint16_t j = 0; j < _need; j++)
+                    raw = (raw << 8) | _scratch[j];
+
+                double value;
+                if (_need == 4)
+                {
+                    uint32_t bits = (uint32_t) raw;
+                    float f;
+                    memcpy(&f, &bits, sizeof(f));
+                    value = f;
+                }
+                else
+                {
+                    memcpy(&value, &raw, sizeof(value));
+                }
+                _value = (int64_t) llround(value * 1000.0);
+                _valueMilli = true;
+                _hasValue = true;
+            }
+
+            elementDone();
+        }
+
+        void HdlcDecoder::elementDone()
+        {
+            while (_depth > 0)
+            {
+                if (--_left[_depth - 1] > 0)
+                    return;
+
+                // The array/structure is complete, which completes an element of its parent
+                if (_obis != OBIS_INVALID && _depth == _obisDepth)
+                    emitRegister();
+                _depth--;
+            }
+
+            _apdu = BODY_DONE;
+        }
+
+        void HdlcDecoder::resetRegister()
+        {
+            _obis = OBIS_INVALID;
+            _obisDepth = 0;
+            _hasValue = false;
+            _value = 0;
+            _valueMilli = false;
+            _hasScaler = false;
+            _scale = 0;
+        }
+
+        void HdlcDecoder::emitRegister()
+        {
+            uint32_t obis = _obis;
+            int8_t scale = _scale;
+            int64_t value = _value;
+            bool valueMilli = _valueMilli;
+            bool hasValue = _hasValue;
+            bool hasScaler = _hasScaler;
+            resetRegister();
+
+            // Codes without a (configured) sensor are dropped before any scaling
+            int8_t slot = lookupObis(obis);
+            if (!hasValue || slot == NO_SLOT || (_wanted & slotBit(slot)) == 0)
+            {
+                return;
+            }
+
+            // Without a scaler/unit a value is taken in the unit of the sensor, except in a
+            // Kamstrup list. Floats are always in the unit of the sensor.
+            if (!hasScaler && !valueMilli && _flatList)
+                scale = kamstrupScale(slot);
+
+            // value * 10^scale in milli-units, i.e. value * 10^(scale+3) unless it is in milli-units already
+            static const int64_t POWERS_OF_TEN[10] = { 1, 10, 100, 1000, 10000, 100000,
+                                                       1000000, 10000000, 100000000, 1000000000 };
+            int exponent = valueMilli ? scale : scale + 3;
+            if (exponent < -9 || exponent > 9)
+            {
+                ESP_LOGE("hdlc", "Scale %d out of range for %d.%d.%d, skipping value.", scale,
+                        (int) (obis >> 16) & 0xff, (int) (obis >> 8) & 0xff, (int) obis & 0xff);
+                return;
+            }
+
+            if (exponent >= 0)
+            {
+                int64_t limit = INT64_MAX / POWERS_OF_TEN[exponent];
+                if (value > limit || value < -limit)
+                {
+                    outOfRange(obis);
+                    return;
+                }
+                value *= POWERS_OF_TEN[exponent];
+            }
+            else
+            {
+                value /= POWERS_OF_TEN[-exponent];
+            }
+
+            // Logged as whole and milli parts, 64 bit printf isn't available everywhere
+            P1_TRACE(D, TRACE_VALUE, obis, (int32_t) value, "hdlc", "VAL %d.%d.%d, %s%ld.%03d, %d",
+                    (int) (obis >> 16) & 0xff, (int) (obis >> 8) & 0xff, (int) obis & 0xff, value < 0 ? "-" : "",
+                    (long) ((value < 0 ? -value : value) / 1000), (int) ((value < 0 ? -value : value) % 1000), scale);
+
+            if (_staging.setValue(slot, value) != NUMBER_OK)
+                outOfRange(obis);
+        }
+
+        void HdlcDecoder::outOfRange(uint32_t obis)
+        {
+            ESP_LOGW("hdlc", "Value of %d.%d.%d out of range, skipping it.",
+                    (int) (obis >> 16) & 0xff, (int) (obis >> 8) & 0xff, (int) obis & 0xff);
+        }
+    }
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aes_gcm.h"
+#include "parsed_message.h"
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        /*  Decodes DLMS push messages in HDLC frames as the bytes come in, without ever
+            holding a whole frame. Length, HCS and FCS are checked on the fly and the values
+            of a frame are only handed over (commit) once its FCS has passed.
+
+            A message too long for one frame is split over several, all but the last with
+            the segmentation bit set in their format. Those are decoded as one stream, the
+            state of the APDU carries over, so the values are handed over once the last
+            frame has passed and nothing is ever reassembled in memory. A segment that is
+            dropped drops the whole message.
+
+            Frame:  7E | format (2) | dest addr (1-4) | src addr (1-4) | control | HCS (2) |
+                         LLC (3) | APDU | FCS (2) | 7E
+            APDU:   0F data-notification | invoke id (4) | date-time (length + bytes) | body
+                    DB general-glo-ciphering | system title (length + 8) | length |
+                         security control | invocation counter (4) | cipher text | tag (12)
+
+            A ciphered APDU is decrypted (AES-128-GCM) byte by byte on its way to the A-XDR
+            decoder, the plain text is a data-notification again. The IV is system title |
+            invocation counter, the tag covers security control | authentication key and is
+            only checked when there is an authentication key.
+
+            The body is A-XDR data, every type is known by its length so anything that isn't
+            of interest is skipped. Every structure holding an OBIS code (octet string of 6)
+            is a register: the OBIS code, a value and optionally a scaler/unit structure, as
+            in "Branschrekommendation v1.2". Codes followed straight by their values in one
+            structure (Kamstrup) work too. Values without a scaler/unit are taken in the unit
+            of their sensor, or in the units Kamstrup sends when they are in such a flat list.
+        */
+        class HdlcDecoder
+        {
+        public:
+            enum Result : uint8_t
+            {
+                NEED_MORE,    // everything consumed, no frame has ended yet
+                FRAME_OK,     // a frame passed all checks, commit() has its values
+                FRAME_ERROR,  // a frame was dropped for its length or structure (and logged)
+                CRC_ERROR,    // a frame was dropped for its HCS or FCS (and logged)
+            };
+
+            // Consumes bytes until the end of a frame or the end of data, whichever comes
+            // first, so the caller can deal with a frame before the next one starts.
+            // Values are only decoded for the slots in wanted.
+            Result feed(const uint8_t *data, size_t len, SlotMask wanted, size_t *consumed);
+
+            // Decrypts ciphered APDUs with decryptionKey, and checks their tag when
+            // authenticationKey isn't nullptr. False when out of memory.
+            bool setKeys(const uint8_t *decryptionKey, const uint8_t *authenticationKey);
+
+            // Copies the values of the frame that just passed into message
+            void commit(ParsedMessage *message) const;
+
+            // FCS of the frame that just passed
+            uint16_t fcs() const { return _fcs; }
+
+            // True between the format field and the closing flag of a frame, or between
+            // the frames of a segmented message
+            bool inFrame() const { return (_state != HUNT && _state != FORMAT_HI) || _continuing; }
+
+            // Gives up on the message being decoded and waits for the next opening flag
+            void reset()
+            {
+                _state = HUNT;
+                _continuing = false;
+            }
+
+        protected:
+            static const uint8_t FLAG = 0x7e;
+            static const uint8_t MAX_ADDRESS_LEN = 4;
+            static const uint8_t MAX_DEPTH = 6;
+            static const uint8_t SCRATCH_LEN = 8;
+            // Bound on the information of a segmented message, in case the last frame never shows
+            static const uint16_t MAX_MESSAGE_LEN = 8192;
+
+            enum FrameState : uint8_t
+            {
+                HUNT,          // looking for an opening flag
+                FORMAT_HI,
+                FORMAT_LO,
+                DEST_ADDR,
+                SRC_ADDR,
+                CONTROL,
+                HCS_LO,
+                HCS_HI,
+                INFO,
+                FCS_LO,
+                FCS_HI,
+                CLOSING_FLAG,
+            };
+
+            enum ApduState : uint8_t
+            {
+                LLC,
+                APDU_TAG,
+                INVOKE_ID,
+                DATETIME_LEN,
+                DATETIME,
+                DATA_TAG,
+                DATA_LEN,
+                DATA_LEN_EXT,
+                DATA_PAYLOAD,
+                COMPACT_TYPE,  // type description of a compact array
+                BODY_DONE,
+                BODY_SKIPPED,  // could not make sense of the rest, what was decoded before still counts
+                APDU_FAILED,
+            };
+
+            enum CipherState : uint8_t
+            {
+                CIPHER_NONE,     // plain APDU
+                CIPHER_TITLE_LEN,
+                CIPHER_TITLE,
+                CIPHER_LEN,
+                CIPHER_LEN_EXT,
+                CIPHER_SECURITY,
+                CIPHER_COUNTER,
+                CIPHER_TEXT,
+                CIPHER_TAG,
+                CIPHER_DONE,
+            };
+
+            // Frame layer
+            FrameState _state{HUNT};
+            uint16_t _remaining{0};     // bytes of the frame left after the current one, incl. FCS
+            uint8_t _addressLen{0};
+            uint16_t _crc{0xffff};
+            uint16_t _checkCrc{0};      // HCS or FCS calculated over the bytes before it
+            uint16_t _fcs{0};
+            uint8_t _received{0};       // low byte of HCS/FCS
+            bool _segment{false};       // the current frame has the segmentation bit set
+            bool _continuing{false};    // a segment has passed, its message goes on in the next frame
+            uint16_t _messageLen{0};    // information bytes of the message so far, across segments
+
+            void startFrame(bool segment);
+            Result dropFrame(const char *reason, Result result = FRAME_ERROR);
+
+            // APDU / A-XDR layer
+            ApduState _apdu{LLC};
+            uint8_t _tag{0};
+            uint16_t _need{0};          // payload, length or header bytes still to come
+            uint16_t _have{0};
+            uint8_t _scratch[SCRATCH_LEN];
+            uint8_t _depth{0};
+            uint16_t _left[MAX_DEPTH];  // elements left in each open array/structure
+            SlotMask _wanted{0};
+
+            void apduByte(uint8_t b);
+            void plainByte(uint8_t b);
+            void cipherFailed(const char *reason, uint8_t b);
+            void dataTag(uint8_t tag);
+            void dataLength(uint16_t len);
+            void valueDone();
+            void elementDone();
+            void skipRestOfBody(const char *reason, uint8_t b);
+
+            // Ciphering layer, wrapped around the APDU
+            static const uint8_t TITLE_LEN = 8;
+            static const uint8_t TAG_LEN = 12;
+            CipherState _cipher{CIPHER_NONE};
+            GcmDecryptor *_gcm{nullptr};        // only with a decryption key
+            uint8_t _authKey[GcmDecryptor::KEY_LEN];
+            bool _authenticate{false};
+            uint8_t _security{0};
+            uint8_t _iv[GcmDecryptor::IV_LEN];   // system title | invocation counter
+            uint8_t _tagReceived[TAG_LEN];
+            uint8_t _cipherPos{0};
+            uint16_t _cipherLeft{0};            // bytes left of the ciphered content
+
+            // The register being decoded
+            uint32_t _obis{OBIS_INVALID};
+            uint8_t _obisDepth{0};
+            bool _hasValue{false};
+            int64_t _value{0};
+            bool _valueMilli{false};    // floats are converted to milli-units as they come in
+            bool _hasScaler{false};
+            bool _flatList{false};      // codes follow each other in one structure (Kamstrup)
+            int8_t _scale{0};
+
+            void resetRegister();
+            void emitRegister();
+            void outOfRange(uint32_t obis);
+
+            // Values of the frame being decoded, only handed over by commit()
+            ParsedMessage _staging;
+        };
+    }
+}
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        // Where each value lives in ParsedMessage, in the order of sensor.py.
+        // The cumulative registers come first, they are the only 64 bit values.
+        enum P1Slot : uint8_t
+        {
+            SLOT_CUMULATIVE_ACTIVE_IMPORT,
+            SLOT_CUMULATIVE_ACTIVE_EXPORT,
+            SLOT_CUMULATIVE_REACTIVE_IMPORT,
+            SLOT_CUMULATIVE_REACTIVE_EXPORT,
+            SLOT_CUMULATIVE_ACTIVE_IMPORT_T1,
+            SLOT_CUMULATIVE_ACTIVE_IMPORT_T2,
+            SLOT_CUMULATIVE_ACTIVE_EXPORT_T1,
+            SLOT_CUMULATIVE_ACTIVE_EXPORT_T2,
+            SLOT_MBUS_1_READING,
+            SLOT_MBUS_2_READING,
+            SLOT_MBUS_3_READING,
+            SLOT_MBUS_4_READING,
+            SLOT_MOMENTARY_ACTIVE_IMPORT,
+            SLOT_MOMENTARY_ACTIVE_EXPORT,
+            SLOT_MOMENTARY_REACTIVE_IMPORT,
+            SLOT_MOMENTARY_REACTIVE_EXPORT,
+            SLOT_MOMENTARY_ACTIVE_IMPORT_L1,
+            SLOT_MOMENTARY_ACTIVE_EXPORT_L1,
+            SLOT_MOMENTARY_ACTIVE_IMPORT_L2,
+            SLOT_MOMENTARY_ACTIVE_EXPORT_L2,
+            SLOT_MOMENTARY_ACTIVE_IMPORT_L3,
+            SLOT_MOMENTARY_ACTIVE_EXPORT_L3,
+            SLOT_MOMENTARY_REACTIVE_IMPORT_L1,
+            SLOT_MOMENTARY_REACTIVE_EXPORT_L1,
+            SLOT_MOMENTARY_REACTIVE_IMPORT_L2,
+            SLOT_MOMENTARY_REACTIVE_EXPORT_L2,
+            SLOT_MOMENTARY_REACTIVE_IMPORT_L3,
+            SLOT_MOMENTARY_REACTIVE_EXPORT_L3,
+            SLOT_VOLTAGE_L1,
+            SLOT_VOLTAGE_L2,
+            SLOT_VOLTAGE_L3,
+            SLOT_CURRENT_L1,
+            SLOT_CURRENT_L2,
+            SLOT_CURRENT_L3,
+            SLOT_TARIFF,
+            SLOT_POWER_FAILURES,
+            SLOT_LONG_POWER_FAILURES,
+            SLOT_VOLTAGE_SAGS_L1,
+            SLOT_VOLTAGE_SAGS_L2,
+            SLOT_VOLTAGE_SAGS_L3,
+            SLOT_VOLTAGE_SWELLS_L1,
+            SLOT_VOLTAGE_SWELLS_L2,
+            SLOT_VOLTAGE_SWELLS_L3,
+            SLOT_COUNT
+        };
+
+        const uint8_t CUMULATIVE_SLOTS = SLOT_MOMENTARY_ACTIVE_IMPORT;
+        const int8_t NO_SLOT = -1;
+
+        // One bit per slot
+        typedef uint64_t SlotMask;
+        static_assert(SLOT_COUNT <= 64, "SlotMask is too small for all slots");
+
+        inline SlotMask slotBit(uint8_t slot)
+        {
+            return (SlotMask) 1 << slot;
+        }
+
+        // Lowest slot set in mask, which must not be 0
+        inline uint8_t lowestSlot(SlotMask mask)
+        {
+            return (uint8_t) __builtin_ctzll(mask);
+        }
+
+        // A-B:C.D.E packed into 32 bits (4 + 4 + 8 + 8 + 8), the F group is always 255 for us
+        constexpr uint32_t obisKey(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint8_t e)
+        {
+            return ((uint32_t) (a & 0x0f) << 28) | ((uint32_t) (b & 0x0f) << 24) |
+                   ((uint32_t) c << 16) | ((uint32_t) d << 8) | e;
+        }
+
+        const uint32_t OBIS_INVALID = 0xffffffff;
+
+        // Packs "A-B:C.D.E" (or "C.D.E", which is taken as 1-0:C.D.E) without looking
+        // past len. Returns OBIS_INVALID for anything else.
+        inline uint32_t obisKeyFromText(const char* text, size_t len)
+        {
+            uint16_t groups[5];
+            uint8_t count = 0;
+            uint16_t group = 0;
+            bool digits = false;
+
+            for (size_t i = 0; i <= len; i++)
+            {
+                char c = i < len ? text[i] : '.';
+                if (c >= '0' && c <= '9')
+                {
+                    group = group * 10 + (c - '0');
+                    digits = true;
+                    if (group > 255)
+                        return OBIS_INVALID;
+                }
+                else if (digits && count < 5 && (c == '-' || c == ':' || c == '.'))
+                {
+                    groups[count++] = group;
+                    group = 0;
+                    digits = false;
+                }
+                else
+                {
+                    return OBIS_INVALID;
+                }
+            }
+
+            if (count == 3)
+                return obisKey(1, 0, groups[0], groups[1], groups[2]);
+            if (count == 5 && groups[0] < 16 && groups[1] < 16)
+                return obisKey(groups[0], groups[1], groups[2], groups[3], groups[4]);
+            return OBIS_INVALID;
+        }
+
+        struct ObisEntry
+        {
+            uint32_t key;
+            uint8_t slot;
+        };
+
+        // Sorted by key. M-Bus readings are 0-n:24.2.1 (DSMR) or 0-n:24.2.3 (e-MUCS), with the
+        // M-Bus channel n as B group. sensor.py defines P1READER_OBIS_FILTER plus one P1READER_OBIS_<sensor>
+        // per configured sensor, so only codes that have a sensor make it into the table and
+        // everything else is turned away by lookupObis before its value is looked at.
+        constexpr ObisEntry OBIS_TABLE[] = {
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_LONG_POWER_FAILURES)
+            {obisKey(0, 0, 96, 7, 9), SLOT_LONG_POWER_FAILURES},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_POWER_FAILURES)
+            {obisKey(0, 0, 96, 7, 21), SLOT_POWER_FAILURES},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_TARIFF)
+            {obisKey(0, 0, 96, 14, 0), SLOT_TARIFF},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MBUS_1_READING)
+            {obisKey(0, 1, 24, 2, 1), SLOT_MBUS_1_READING},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MBUS_1_READING)
+            {obisKey(0, 1, 24, 2, 3), SLOT_MBUS_1_READING},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MBUS_2_READING)
+            {obisKey(0, 2, 24, 2, 1), SLOT_MBUS_2_READING},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MBUS_2_READING)
+            {obisKey(0, 2, 24, 2, 3), SLOT_MBUS_2_READING},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MBUS_3_READING)
+            {obisKey(0, 3, 24, 2, 1), SLOT_MBUS_3_READING},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MBUS_3_READING)
+            {obisKey(0, 3, 24, 2, 3), SLOT_MBUS_3_READING},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MBUS_4_READING)
+            {obisKey(0, 4, 24, 2, 1), SLOT_MBUS_4_READING},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MBUS_4_READING)
+            {obisKey(0, 4, 24, 2, 3), SLOT_MBUS_4_READING},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_ACTIVE_IMPORT)
+            {obisKey(1, 0, 1, 7, 0), SLOT_MOMENTARY_ACTIVE_IMPORT},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CUMULATIVE_ACTIVE_IMPORT)
+            {obisKey(1, 0, 1, 8, 0), SLOT_CUMULATIVE_ACTIVE_IMPORT},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CUMULATIVE_ACTIVE_IMPORT_T1)
+            {obisKey(1, 0, 1, 8, 1), SLOT_CUMULATIVE_ACTIVE_IMPORT_T1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CUMULATIVE_ACTIVE_IMPORT_T2)
+            {obisKey(1, 0, 1, 8, 2), SLOT_CUMULATIVE_ACTIVE_IMPORT_T2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_ACTIVE_EXPORT)
+            {obisKey(1, 0, 2, 7, 0), SLOT_MOMENTARY_ACTIVE_EXPORT},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CUMULATIVE_ACTIVE_EXPORT)
+            {obisKey(1, 0, 2, 8, 0), SLOT_CUMULATIVE_ACTIVE_EXPORT},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CUMULATIVE_ACTIVE_EXPORT_T1)
+            {obisKey(1, 0, 2, 8, 1), SLOT_CUMULATIVE_ACTIVE_EXPORT_T1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CUMULATIVE_ACTIVE_EXPORT_T2)
+            {obisKey(1, 0, 2, 8, 2), SLOT_CUMULATIVE_ACTIVE_EXPORT_T2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_REACTIVE_IMPORT)
+            {obisKey(1, 0, 3, 7, 0), SLOT_MOMENTARY_REACTIVE_IMPORT},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CUMULATIVE_REACTIVE_IMPORT)
+            {obisKey(1, 0, 3, 8, 0), SLOT_CUMULATIVE_REACTIVE_IMPORT},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_REACTIVE_EXPORT)
+            {obisKey(1, 0, 4, 7, 0), SLOT_MOMENTARY_REACTIVE_EXPORT},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CUMULATIVE_REACTIVE_EXPORT)
+            {obisKey(1, 0, 4, 8, 0), SLOT_CUMULATIVE_REACTIVE_EXPORT},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_ACTIVE_IMPORT_L1)
+            {obisKey(1, 0, 21, 7, 0), SLOT_MOMENTARY_ACTIVE_IMPORT_L1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_ACTIVE_EXPORT_L1)
+            {obisKey(1, 0, 22, 7, 0), SLOT_MOMENTARY_ACTIVE_EXPORT_L1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_REACTIVE_IMPORT_L1)
+            {obisKey(1, 0, 23, 7, 0), SLOT_MOMENTARY_REACTIVE_IMPORT_L1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_REACTIVE_EXPORT_L1)
+            {obisKey(1, 0, 24, 7, 0), SLOT_MOMENTARY_REACTIVE_EXPORT_L1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CURRENT_L1)
+            {obisKey(1, 0, 31, 7, 0), SLOT_CURRENT_L1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_L1)
+            {obisKey(1, 0, 32, 7, 0), SLOT_VOLTAGE_L1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_SAGS_L1)
+            {obisKey(1, 0, 32, 32, 0), SLOT_VOLTAGE_SAGS_L1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_SWELLS_L1)
+            {obisKey(1, 0, 32, 36, 0), SLOT_VOLTAGE_SWELLS_L1},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_ACTIVE_IMPORT_L2)
+            {obisKey(1, 0, 41, 7, 0), SLOT_MOMENTARY_ACTIVE_IMPORT_L2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_ACTIVE_EXPORT_L2)
+            {obisKey(1, 0, 42, 7, 0), SLOT_MOMENTARY_ACTIVE_EXPORT_L2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_REACTIVE_IMPORT_L2)
+            {obisKey(1, 0, 43, 7, 0), SLOT_MOMENTARY_REACTIVE_IMPORT_L2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_REACTIVE_EXPORT_L2)
+            {obisKey(1, 0, 44, 7, 0), SLOT_MOMENTARY_REACTIVE_EXPORT_L2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CURRENT_L2)
+            {obisKey(1, 0, 51, 7, 0), SLOT_CURRENT_L2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_L2)
+            {obisKey(1, 0, 52, 7, 0), SLOT_VOLTAGE_L2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_SAGS_L2)
+            {obisKey(1, 0, 52, 32, 0), SLOT_VOLTAGE_SAGS_L2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_SWELLS_L2)
+            {obisKey(1, 0, 52, 36, 0), SLOT_VOLTAGE_SWELLS_L2},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_ACTIVE_IMPORT_L3)
+            {obisKey(1, 0, 61, 7, 0), SLOT_MOMENTARY_ACTIVE_IMPORT_L3},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_ACTIVE_EXPORT_L3)
+            {obisKey(1, 0, 62, 7, 0), SLOT_MOMENTARY_ACTIVE_EXPORT_L3},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_REACTIVE_IMPORT_L3)
+            {obisKey(1, 0, 63, 7, 0), SLOT_MOMENTARY_REACTIVE_IMPORT_L3},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_MOMENTARY_REACTIVE_EXPORT_L3)
+            {obisKey(1, 0, 64, 7, 0), SLOT_MOMENTARY_REACTIVE_EXPORT_L3},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_CURRENT_L3)
+            {obisKey(1, 0, 71, 7, 0), SLOT_CURRENT_L3},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_L3)
+            {obisKey(1, 0, 72, 7, 0), SLOT_VOLTAGE_L3},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_SAGS_L3)
+            {obisKey(1, 0, 72, 32, 0), SLOT_VOLTAGE_SAGS_L3},
+#endif
+#if !defined(P1READER_OBIS_FILTER) || defined(P1READER_OBIS_VOLTAGE_SWELLS_L3)
+            {obisKey(1, 0, 72, 36, 0), SLOT_VOLTAGE_SWELLS_L3},
+#endif
+            // Keeps the table non-empty, OBIS_INVALID never matches a parsed code
+            {OBIS_INVALID, SLOT_COUNT},
+        };
+
+        const size_t OBIS_TABLE_SIZE = sizeof(OBIS_TABLE) / sizeof(OBIS_TABLE[0]);
+
+        constexpr bool obisTableSorted()
+        {
+            for (size_t i = 1; i < OBIS_TABLE_SIZE; i++)
+                if (OBIS_TABLE[i - 1].key >= OBIS_TABLE[i].key)
+                    return false;
+            return true;
+        }
+
+        static_assert(obisTableSorted(), "OBIS_TABLE must be sorted by key");
+
+        // Returns the slot for key, or NO_SLOT when the code has no (configured) sensor
+        inline int8_t lookupObis(uint32_t key)
+        {
+            size_t low = 0;
+            size_t high = OBIS_TABLE_SIZE - 1; // the sentinel is never a match
+            while (low < high)
+            {
+                size_t mid = (low + high) / 2;
+                if (OBIS_TABLE[mid].key < key)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            return low < OBIS_TABLE_SIZE - 1 && OBIS_TABLE[low].key == key ? OBIS_TABLE[low].slot : NO_SLOT;
+        }
+
+        // Text values for the text sensors, in the order of text_sensor.py
+        enum P1TextSlot : uint8_t
+        {
+            TEXT_TIMESTAMP,
+            TEXT_EQUIPMENT_ID,
+            TEXT_DSMR_VERSION,
+            TEXT_MESSAGE,
+            TEXT_MBUS_1_TIMESTAMP,
+            TEXT_MBUS_2_TIMESTAMP,
+            TEXT_MBUS_3_TIMESTAMP,
+            TEXT_MBUS_4_TIMESTAMP,
+            TEXT_SLOT_COUNT
+        };
+
+        // One bit per text slot
+        typedef uint16_t TextMask;
+        static_assert(TEXT_SLOT_COUNT <= 16, "TextMask is too small for all text slots");
+
+        // Longest text kept per slot, anything longer is cut off. Timestamps are YYMMDDhhmmssX.
+        constexpr uint8_t TEXT_CAPACITY[TEXT_SLOT_COUNT] = {13, 48, 8, 48, 13, 13, 13, 13};
+
+        // Where each slot starts in ParsedMessage::texts
+        constexpr uint16_t textOffset(uint8_t slot)
+        {
+            uint16_t offset = 0;
+            for (uint8_t i = 0; i < slot; i++)
+                offset += TEXT_CAPACITY[i];
+            return offset;
+        }
+
+        const uint16_t TEXT_BUFFER_LEN = textOffset(TEXT_SLOT_COUNT);
+
+        struct TextEntry
+        {
+            uint32_t key;
+            uint8_t slot;
+            bool hex;    // hex encoded characters, as the equipment id and the message are
+            bool first;  // from the first (...) of the line, the timestamp of an M-Bus reading
+        };
+
+        constexpr TextEntry TEXT_TABLE[] = {
+            {obisKey(0, 0, 1, 0, 0), TEXT_TIMESTAMP, false, false},
+            {obisKey(0, 0, 96, 1, 1), TEXT_EQUIPMENT_ID, true, false},
+            {obisKey(1, 3, 0, 2, 8), TEXT_DSMR_VERSION, false, false},
+            {obisKey(0, 0, 96, 13, 0), TEXT_MESSAGE, true, false},
+            {obisKey(0, 1, 24, 2, 1), TEXT_MBUS_1_TIMESTAMP, false, true},
+            {obisKey(0, 2, 24, 2, 1), TEXT_MBUS_2_TIMESTAMP, false, true},
+            {obisKey(0, 3, 24, 2, 1), TEXT_MBUS_3_TIMESTAMP, false, true},
+            {obisKey(0, 4, 24, 2, 1), TEXT_MBUS_4_TIMESTAMP, false, true},
+            {obisKey(0, 1, 24, 2, 3), TEXT_MBUS_1_TIMESTAMP, false, true},
+            {obisKey(0, 2, 24, 2, 3), TEXT_MBUS_2_TIMESTAMP, false, true},
+            {obisKey(0, 3, 24, 2, 3), TEXT_MBUS_3_TIMESTAMP, false, true},
+            {obisKey(0, 4, 24, 2, 3), TEXT_MBUS_4_TIMESTAMP, false, true},
+        };
+
+        // The text entry for key, or nullptr. A handful of entries, a linear search is enough.
+        inline const TextEntry *lookupText(uint32_t key)
+        {
+            for (const TextEntry &entry : TEXT_TABLE)
+                if (entry.key == key)
+                    return &entry;
+            return nullptr;
+        }
+    }
+}
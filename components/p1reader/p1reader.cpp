@@ -22,12 +22,32 @@
 // IN THE SOFTWARE.
 //-------------------------------------------------------------------------------------
 
+#include <algorithm>
+#include <cmath>
+#include <new>
+
 #include "p1reader.h"
 
 namespace esphome
 {
     namespace p1_reader
     {
+        bool P1Reader::parseKey(const std::string &hex, uint8_t *key)
+        {
+            if (hex.size() != 2 * GcmDecryptor::KEY_LEN)
+                return false;
+
+            for (uint8_t i = 0; i < GcmDecryptor::KEY_LEN; i++)
+            {
+                char digits[3] = {hex[2 * i], hex[2 * i + 1], 0};
+                char *end;
+                key[i] = (uint8_t) strtoul(digits, &end, 16);
+                if (end != digits + 2)
+                    return false;
+            }
+            return true;
+        }
+
         void P1Reader::setup()
         {
             // Calculate pollingInterval for Component given our uart buffer size and the rest
@@ -37,602 +57,822 @@ namespace esphome
             float secondsPerByte = (float)bits * (1.0f / (float) parent_->get_baud_rate());
 
             ESP_LOGI("setup", "secondsPerByte calculated as: %f s", secondsPerByte);
-            
-            _uSecondsPerByte = (int) (secondsPerByte * 1000000.0f);
-            // Keep a margin of 20%
-            _pollingIntervalMs = (int)((float)rxBufferSize * secondsPerByte * 800.0f);
-            
-            if (_pollingIntervalMs < 20)
+
+            if (_readerTaskMode)
             {
-                ESP_LOGE("setup", "Polling interval is too low: %d ms (rx_buffer_size %d, uSecondsPerByte %d)", 
-                    _pollingIntervalMs, parent_->get_rx_buffer_size(), _uSecondsPerByte);
-            } 
-            else if (_pollingIntervalMs < 100)
+                // The reader task sleeps between polls of the UART for a quarter of the
+                // time rx_buffer_size takes to fill, but no more than 20 ms so values stay prompt
+                _pollingIntervalMs = 0;
+                _frameTimeoutMs = 100;
+                int bufferMs = (int)((float)rxBufferSize * secondsPerByte * 1000.0f);
+                int delayMs = std::max(1, std::min(20, bufferMs / 4));
+#ifdef USE_ESP32
+                _readerTaskDelay = std::max((TickType_t) 1, (TickType_t) pdMS_TO_TICKS(delayMs));
+                _readBudget = &_taskBudget;
+#endif
+                ESP_LOGI("setup", "Reading from a task on core 1 every %d ms, rx_buffer_size %d holds %d ms of data", 
+                        delayMs, (int) rxBufferSize, bufferMs);
+            }
+            else if (_loopMode)
             {
-                ESP_LOGW("setup", "Polling interval is low: %d ms (rx_buffer_size %d, uSecondsPerByte %d)", 
-                        _pollingIntervalMs, parent_->get_rx_buffer_size(), _uSecondsPerByte);
+                // loop() does all the work, the poller never calls update()
+                _pollingIntervalMs = 0;
+                _frameTimeoutMs = 100;
+                int bufferMs = (int)((float)rxBufferSize * secondsPerByte * 1000.0f);
+                if (bufferMs < 50)
+                {
+                    ESP_LOGW("setup", "Reading from loop(), but rx_buffer_size %d only holds %d ms of data", 
+                            (int) rxBufferSize, bufferMs);
+                }
+                else
+                {
+                    ESP_LOGI("setup", "Reading from loop(), rx_buffer_size %d holds %d ms of data", 
+                            (int) rxBufferSize, bufferMs);
+                }
             }
             else
             {
-                ESP_LOGI("setup", "Polling interval calculated as: %d ms (rx_buffer_size %d, uSecondsPerByte %d)", 
-                        _pollingIntervalMs, parent_->get_rx_buffer_size(), _uSecondsPerByte);
+                // Keep a margin of 20%
+                _pollingIntervalMs = (int)((float)rxBufferSize * secondsPerByte * 800.0f);
+                // Between two polls the rest of a frame always arrives, unless bytes got lost
+                _frameTimeoutMs = 2 * _pollingIntervalMs;
+            
+                if (_pollingIntervalMs < 20)
+                {
+                    ESP_LOGE("setup", "Polling interval is too low: %d ms (rx_buffer_size %d)", 
+                        _pollingIntervalMs, (int) parent_->get_rx_buffer_size());
+                } 
+                else if (_pollingIntervalMs < 100)
+                {
+                    ESP_LOGW("setup", "Polling interval is low: %d ms (rx_buffer_size %d)", 
+                            _pollingIntervalMs, (int) parent_->get_rx_buffer_size());
+                }
+                else
+                {
+                    ESP_LOGI("setup", "Polling interval calculated as: %d ms (rx_buffer_size %d)", 
+                            _pollingIntervalMs, (int) parent_->get_rx_buffer_size());
+                }
             }
                 
-            set_update_interval(_pollingIntervalMs);
+            // ESPHome starts the poller before setup(), at the interval from the constructor.
+            // Changing the interval doesn't reschedule it, restarting the poller does.
+            if (_readerTaskMode || _loopMode)
+            {
+                stop_poller();
+            }
+            else
+            {
+                set_update_interval(_pollingIntervalMs);
+                start_poller();
+            }
+
+            if (_captureTelegram && readP1Message == &P1Reader::readP1MessageAscii)
+            {
+                readP1Message = &P1Reader::readP1MessageAsciiTelegram;
+                ESP_LOGI("setup", "Capturing whole telegrams of up to %d bytes", (int) _bufferSize);
+            }
 
-            // Start with a clean buffer
-            memset(_buffer, 0, BUF_SIZE);
+            // Only ASCII needs a buffer, HDLC frames are decoded as they come in. Each reader
+            // gets its own so meters with different protocols and sizes can share a device.
             _bufferLen = 0;
-            ESP_LOGI("setup", "Internal buffer size is %d", BUF_SIZE);
+            if (readP1Message != &P1Reader::readP1MessageHDLC)
+            {
+                _buffer = new (std::nothrow) char[_bufferSize];
+                if (_buffer == nullptr)
+                {
+                    ESP_LOGE("setup", "Could not allocate a buffer of %d bytes", (int) _bufferSize);
+                    mark_failed();
+                    return;
+                }
+                memset(_buffer, 0, _bufferSize);
+                ESP_LOGI("setup", "Internal buffer size is %d", (int) _bufferSize);
+            }
+            else if (_hasDecryptionKey)
+            {
+                if (!_hdlc.setKeys(_decryptionKey, _hasAuthenticationKey ? _authenticationKey : nullptr))
+                {
+                    ESP_LOGE("setup", "Could not allocate the decryption state");
+                    mark_failed();
+                    return;
+                }
+                ESP_LOGI("setup", "Decrypting ciphered messages, %s", 
+                        _hasAuthenticationKey ? "checking their tag" : "without an authentication_key to check their tag");
+            }
+
+            // Values are only parsed and published for slots that have a sensor
+            sensor::Sensor *sensors[SLOT_COUNT] = {
+                cumulative_active_import, cumulative_active_export,
+                cumulative_reactive_import, cumulative_reactive_export,
+                cumulative_active_import_t1, cumulative_active_import_t2,
+                cumulative_active_export_t1, cumulative_active_export_t2,
+                mbus_1_reading, mbus_2_reading, mbus_3_reading, mbus_4_reading,
+                momentary_active_import, momentary_active_export,
+                momentary_reactive_import, momentary_reactive_export,
+                momentary_active_import_l1, momentary_active_export_l1,
+                momentary_active_import_l2, momentary_active_export_l2,
+                momentary_active_import_l3, momentary_active_export_l3,
+                momentary_reactive_import_l1, momentary_reactive_export_l1,
+                momentary_reactive_import_l2, momentary_reactive_export_l2,
+                momentary_reactive_import_l3, momentary_reactive_export_l3,
+                voltage_l1, voltage_l2, voltage_l3,
+                current_l1, current_l2, current_l3,
+                tariff, power_failures, long_power_failures,
+                voltage_sags_l1, voltage_sags_l2, voltage_sags_l3,
+                voltage_swells_l1, voltage_swells_l2, voltage_swells_l3,
+            };
+
+            _configuredSlots = 0;
+            int configured = 0;
+            for (uint8_t slot = 0; slot < SLOT_COUNT; slot++)
+            {
+                _slotSensors[slot] = sensors[slot];
+                if (sensors[slot] != nullptr)
+                {
+                    _configuredSlots |= slotBit(slot);
+                    configured++;
+                }
+            }
+            ESP_LOGI("setup", "%d of %d sensors configured", configured, (int) SLOT_COUNT);
+
+            _configuredTexts = 0;
+            for (uint8_t textSlot = 0; textSlot < TEXT_SLOT_COUNT; textSlot++)
+            {
+                if (_textSensors[textSlot] != nullptr)
+                    _configuredTexts |= 1 << textSlot;
+            }
+
+            _messages[0].initNewTelegram();
+            _messages[1].initNewTelegram();
+
+            if (_diagTelegramsPerMinute != nullptr || _diagCrcFailures != nullptr || _diagFrameErrors != nullptr ||
+                _diagMaxUpdateTime != nullptr || _diagPublishLatency != nullptr || _diagUartHighWater != nullptr)
+            {
+                _diag.lastPublishMs = millis();
+                set_interval("diagnostics", DIAGNOSTICS_INTERVAL_MS, [this]() { publishDiagnostics(); });
+            }
+
+#ifdef USE_ESP32
+            if (_readerTaskMode &&
+                xTaskCreatePinnedToCore(readerTask, "p1reader", READER_TASK_STACK, this,
+                                        READER_TASK_PRIORITY, &_readerTask, READER_TASK_CORE) != pdPASS)
+            {
+                ESP_LOGE("setup", "Could not start the reader task");
+                mark_failed();
+            }
+#endif
+        }
+
+#ifdef USE_ESP32
+        void P1Reader::readerTask(void *param)
+        {
+            P1Reader *reader = (P1Reader *) param;
+            for (;;)
+            {
+                // Sleep through the quiet part of the meter's interval
+                bool pending = reader->stageRxBytes() > 0 || reader->_captureState == CAPTURE_PARSING;
+                if (!pending)
+                {
+                    vTaskDelay(reader->_readerTaskDelay);
+                    continue;
+                }
 
-            _parsedMessage.initNewTelegram();
+                reader->_taskBudget.startSlice();
+                (reader->*(reader->readP1Message))();
+
+                // Let the main loop on this core have a tick, the budget may have cut the read short
+                vTaskDelay(1);
+            }
+        }
+#endif
+
+        void P1Reader::loop()
+        {
+            if (_readerTaskMode)
+            {
+                publishQueuedTelegram();
+                return;
+            }
+
+            if (!_loopMode)
+            {
+                return;
+            }
+
+            // Wake up for work left over from the last call, for a reasonable chunk of data,
+            // or for whatever is left once the meter stops sending (the !CRC line is only a few bytes)
+            bool pending = _publishing != nullptr || _rxPos < _rxLen || _captureState == CAPTURE_PARSING;
+            if (!pending)
+            {
+                int avail = available();
+                if (avail == 0)
+                {
+                    _highFrequencyLoop.stop();
+                    return;
+                }
+
+                // The meter is sending, don't sit out the normal loop interval until it is done
+                _highFrequencyLoop.start();
+
+                if (avail < LOOP_WAKE_BYTES && avail != _lastAvailable)
+                {
+                    _lastAvailable = avail;
+                    return;
+                }
+            }
+
+            _lastAvailable = 0;
+            readAndPublish();
         }
 
         void P1Reader::update()
         {
-            // Deliver a parsed and crc ok message in the calls _after_ actually reading it so we 
-            // split the work over more scheduler slices since publish_state is slow (and logging is slow
-            // so set log level INFO to avoid all the debug logging slowing things down)
-            if (_parsedMessage.telegramComplete)
+            // The reader task or loop() own the UART and the parsers, update() must not touch
+            // them even when called by a component.update action
+            if (_readerTaskMode || _loopMode)
+                return;
+
+            readAndPublish();
+        }
+
+        void P1Reader::readAndPublish()
+        {
+            // Reading and publishing share one time budget per call. Reading goes first and never
+            // waits for publishing, they work on different messages (see completeTelegram).
+            // publish_state is slow (and logging is slow so set log level INFO to avoid all the
+            // debug logging slowing things down), it gets what is left of the budget.
+            _timeBudget.startSlice();
+
+            (this->*readP1Message)();
+
+            // At least one value per call however long reading took, publishSensors() only
+            // stops between values
+            if (_publishing != nullptr)
+            {
+                publishSensors(_publishing);
+            }
+
+            _diag.noteCall(_timeBudget.elapsedUs());
+        }
+
+        void P1Reader::publishDiagnostics()
+        {
+            uint32_t now = millis();
+            uint32_t telegrams = _diag.telegrams.load(std::memory_order_relaxed);
+
+            if (_diagTelegramsPerMinute != nullptr && now != _diag.lastPublishMs)
+            {
+                _diagTelegramsPerMinute->publish_state((telegrams - _diag.lastTelegrams) * 60000.0f / (now - _diag.lastPublishMs));
+            }
+            if (_diagCrcFailures != nullptr)
             {
-                publishSensors(&_parsedMessage);
+                _diagCrcFailures->publish_state(_diag.crcFailures.load(std::memory_order_relaxed));
+            }
+            if (_diagFrameErrors != nullptr)
+            {
+                _diagFrameErrors->publish_state(_diag.frameErrors.load(std::memory_order_relaxed));
+            }
+            if (_diagMaxUpdateTime != nullptr)
+            {
+                _diagMaxUpdateTime->publish_state(_diag.maxCallUs / 1000.0f);
+            }
+            if (_diagPublishLatency != nullptr)
+            {
+                // Unknown rather than 0 when nothing was published
+                _diagPublishLatency->publish_state(_telegramsPublished != _diagLastPublished ? (float) _diag.maxLatencyMs : NAN);
+            }
+            if (_diagUartHighWater != nullptr)
+            {
+                _diagUartHighWater->publish_state(_diag.uartHighWater.load(std::memory_order_relaxed));
+            }
+
+            _diag.lastTelegrams = telegrams;
+            _diag.lastPublishMs = now;
+            _diag.maxCallUs = 0;
+            _diag.maxLatencyMs = 0;
+            _diagLastPublished = _telegramsPublished;
+        }
 
-                if (!_parsedMessage.telegramComplete)
+        void P1Reader::publishQueuedTelegram()
+        {
+            if (_publishing == nullptr)
+            {
+                _publishing = _telegramQueue.front();
+                if (_publishing == nullptr)
                 {
-                    (this->*readP1Message)();
+                    _highFrequencyLoop.stop();
+                    return;
                 }
+
+                // Keep loop() coming until the telegram has been published
+                _highFrequencyLoop.start();
             }
-            else
+
+            _timeBudget.startSlice();
+            publishSensors(_publishing);
+            _diag.noteCall(_timeBudget.elapsedUs());
+
+            // publishSensors lets go of the message once it is done with it
+            if (_publishing == nullptr)
             {
-                (this->*readP1Message)();
+                _telegramQueue.pop();
             }
         }
 
+        void P1Reader::completeTelegram()
+        {
+            if (!_reading->crcOk)
+            {
+                Diagnostics::count(_diag.crcFailures);
+                _reading->initNewTelegram();
+                return;
+            }
+            Diagnostics::count(_diag.telegrams);
+
+            // The reader task hands a copy to the main loop and carries on in the same message
+            if (_readerTaskMode)
+            {
+                if (!_telegramQueue.push(*_reading))
+                {
+                    ESP_LOGW("publish", "Telegram %04X dropped, the main loop is behind on publishing", _reading->crc);
+                }
+                _reading->initNewTelegram();
+                return;
+            }
+
+            // A telegram is published long before the next one is read, unless publishing
+            // keeps running out of time. The newer values win then.
+            if (_publishing != nullptr)
+            {
+                ESP_LOGW("publish", "Telegram %04X not fully published when the next one was read, skipping the rest of it", 
+                        _publishing->crc);
+            }
+
+            _publishing = _reading;
+            _reading = _reading == &_messages[0] ? &_messages[1] : &_messages[0];
+            _reading->initNewTelegram();
+        }
+
         void P1Reader::publishSensors(ParsedMessage* parsedMessage)
         {
-            if (parsedMessage->crcOk && parsedMessage->telegramComplete)
+            uint32_t now = millis();
+            _timeBudget.skipStep();
+
+            // Only slots with a sensor are ever parsed, so every bit left here has one.
+            // Bits are cleared as they are published, so the next slice picks up where we stopped.
+            while (parsedMessage->sensorsToSend != 0)
             {
-                uint32_t start = millis();
-    
-                while (parsedMessage->sensorsToSend > 0)
+                uint8_t slot = lowestSlot(parsedMessage->sensorsToSend);
+                parsedMessage->sensorsToSend &= ~slotBit(slot);
+                publishSlot(slot, parsedMessage, now);
+
+                // Every step is timed, the last one of a telegram too
+                bool fits = _timeBudget.stepDone(PHASE_PUBLISH);
+                if (!fits && (parsedMessage->sensorsToSend != 0 || parsedMessage->textsToSend != 0))
                 {
-                    switch (parsedMessage->sensorsToSend--)
-                    {
-                        case 1:
-                            if (cumulative_active_import != nullptr)
-                                cumulative_active_import->publish_state(parsedMessage->cumulativeActiveImport);
-                            break;
-                        case 2:
-                            if (cumulative_active_export != nullptr)
-                                cumulative_active_export->publish_state(parsedMessage->cumulativeActiveExport);
-                            break;
-                        case 3:
-                            if (momentary_active_import != nullptr)
-                                momentary_active_import->publish_state(parsedMessage->momentaryActiveImport);
-                            break;
-                        case 4:
-                            if (momentary_active_export != nullptr)
-                                momentary_active_export->publish_state(parsedMessage->momentaryActiveExport);
-                            break;
-                        case 5:
-                            if (momentary_active_import_l1 != nullptr)
-                                momentary_active_import_l1->publish_state(parsedMessage->momentaryActiveImportL1);
-                            break;
-                        case 6:
-                            if (momentary_active_export_l1 != nullptr)
-                                momentary_active_export_l1->publish_state(parsedMessage->momentaryActiveExportL1);
-                            break;
-                        case 7:
-                            if (momentary_active_import_l2 != nullptr)
-                                momentary_active_import_l2->publish_state(parsedMessage->momentaryActiveImportL2);
-                            break;
-                        case 8:
-                            if (momentary_active_export_l2 != nullptr)
-                                momentary_active_export_l2->publish_state(parsedMessage->momentaryActiveExportL2);
-                            break;
-                        case 9:
-                            if (momentary_active_import_l3 != nullptr)
-                                momentary_active_import_l3->publish_state(parsedMessage->momentaryActiveImportL3);
-                            break;
-                        case 10:
-                            if (momentary_active_export_l3 != nullptr)
-                                momentary_active_export_l3->publish_state(parsedMessage->momentaryActiveExportL3);
-                            break;
-                        case 11:
-                            if (voltage_l1 != nullptr)
-                                voltage_l1->publish_state(parsedMessage->voltageL1);
-                            break;
-                        case 12:
-                            if (voltage_l2 != nullptr)
-                                voltage_l2->publish_state(parsedMessage->voltageL2);
-                            break;
-                        case 13:
-                            if (voltage_l3 != nullptr)
-                                voltage_l3->publish_state(parsedMessage->voltageL3);
-                            break;
-                        case 14:
-                            if (current_l1 != nullptr)
-                                current_l1->publish_state(parsedMessage->currentL1);
-                            break;
-                        case 15:
-                            if (current_l2 != nullptr)
-                                current_l2->publish_state(parsedMessage->currentL2);
-                            break;
-                        case 16:
-                            if (current_l3 != nullptr)
-                                current_l3->publish_state(parsedMessage->currentL3);
-                            break;
-                        case 17:
-                            if (cumulative_reactive_import != nullptr)
-                                cumulative_reactive_import->publish_state(parsedMessage->cumulativeReactiveImport);
-                            break;
-                        case 18:
-                            if (cumulative_reactive_export != nullptr)
-                                cumulative_reactive_export->publish_state(parsedMessage->cumulativeReactiveExport);
-                            break;
-                        case 19:
-                            if (momentary_reactive_import != nullptr)
-                                momentary_reactive_import->publish_state(parsedMessage->momentaryReactiveImport);
-                            break;
-                        case 20:
-                            if (momentary_reactive_export != nullptr)
-                                momentary_reactive_export->publish_state(parsedMessage->momentaryReactiveExport);
-                            break;
-                        case 21:
-                            if (momentary_reactive_import_l1 != nullptr)
-                                momentary_reactive_import_l1->publish_state(parsedMessage->momentaryReactiveImportL1);
-                            break;
-                        case 22:
-                            if (momentary_reactive_export_l1 != nullptr)
-                                momentary_reactive_export_l1->publish_state(parsedMessage->momentaryReactiveExportL1);
-                            break;
-                        case 23:
-                            if (momentary_reactive_import_l2 != nullptr)
-                                momentary_reactive_import_l2->publish_state(parsedMessage->momentaryReactiveImportL2);
-                            break;
-                        case 24:
-                            if (momentary_reactive_export_l2 != nullptr)
-                                momentary_reactive_export_l2->publish_state(parsedMessage->momentaryReactiveExportL2);
-                            break;
-                        case 25:
-                            if (momentary_reactive_import_l3 != nullptr)
-                                momentary_reactive_import_l3->publish_state(parsedMessage->momentaryReactiveImportL3);
-                            break;
-                        case 26:
-                            if (momentary_reactive_export_l3 != nullptr)
-                                momentary_reactive_export_l3->publish_state(parsedMessage->momentaryReactiveExportL3);
-                            break;
-                        default:
-                            // Unused
-                            break;
-                    }
+                    return; // Wait for next execution slice
+                }
+            }
 
-                    if ((millis() - start) > 20)
-                    {
-                        return; // Wait for next execution slice
-                    }
+            while (parsedMessage->textsToSend != 0)
+            {
+                uint8_t textSlot = (uint8_t) __builtin_ctz(parsedMessage->textsToSend);
+                parsedMessage->textsToSend &= ~(1 << textSlot);
+                publishText(textSlot, parsedMessage);
+
+                bool fits = _timeBudget.stepDone(PHASE_PUBLISH);
+                if (!fits && parsedMessage->textsToSend != 0)
+                {
+                    return; // Wait for next execution slice
                 }
+            }
 
-                ESP_LOGI("publish", "Sensors published (complete). CRC: %04X", parsedMessage->crc);
-                parsedMessage->initNewTelegram();
+            _telegramsPublished++;
+            _diag.noteLatency(millis() - parsedMessage->receivedMs);
+            ESP_LOGI("publish", "Sensors published (complete). CRC: %04X", parsedMessage->crc);
+            ESP_LOGD("publish", "Step estimates: read %u us, publish %u us (budget %u us)",
+                    (unsigned) _readBudget->estimateUs(PHASE_READ), (unsigned) _timeBudget.estimateUs(PHASE_PUBLISH),
+                    (unsigned) _timeBudget.budgetUs());
+            _publishing = nullptr;
+        }
+    
+        void P1Reader::publishSlot(uint8_t slot, ParsedMessage* parsedMessage, uint32_t now)
+        {
+            sensor::Sensor *sensor = _slotSensors[slot];
+            if (sensor == nullptr)
+            {
+                return;
             }
-            else if (!parsedMessage->crcOk && parsedMessage->telegramComplete)
+
+            int64_t value = parsedMessage->getMilli(slot);
+            PublishFilter &filter = _publishFilters[slot];
+            if (filter.shouldPublish(value, now))
             {
-                parsedMessage->initNewTelegram();
+                sensor->publish_state(parsedMessage->getValue(slot));
+                filter.markPublished(value, now);
             }
         }
-    
+
+        void P1Reader::publishText(uint8_t textSlot, ParsedMessage* parsedMessage)
+        {
+            text_sensor::TextSensor *sensor = _textSensors[textSlot];
+            if (sensor == nullptr)
+            {
+                return;
+            }
+
+            // Only on change, the string for publish_state is the one allocation per text
+            const char *text = parsedMessage->getText(textSlot);
+            uint8_t len = parsedMessage->textLen[textSlot];
+            if (sensor->has_state() && sensor->state.size() == len && memcmp(sensor->state.data(), text, len) == 0)
+            {
+                return;
+            }
+            sensor->publish_state(std::string(text, len));
+        }
+
         void P1Reader::readP1MessageAscii()
         {
-            uint32_t start = millis();
-            while (available())
+            _readBudget->skipStep();
+            while (stageRxBytes() > 0)
             {
-                int len = readBytesUntilAndIncluding('\n', _buffer + _bufferLen, BUF_SIZE-_bufferLen);
+                int len = readBytesUntilAndIncluding('\n', _buffer + _bufferLen, _bufferSize - _bufferLen);
 
                 if (len > 0)
                 {
                     _bufferLen += len;
                     bool lineComplete = _buffer[_bufferLen-1] == '\n';
                 
-                    if (lineComplete)
+                    if (lineComplete && _discardLine)
                     {
-                        // if we've reached the CRC checksum, calculate last CRC and compare
+                        // The rest of a line that didn't fit, not a line of its own
+                        _discardLine = false;
+                        _bufferLen = 0;
+                    }
+                    else if (lineComplete)
+                    {
+                        // if we've reached the CRC checksum, compare it with the one folded in while reading
                         if (_buffer[0] == '!')
                         {
-                            _parsedMessage.updateCrc16(_buffer[0]);
                             int crcFromMsg = (int) strtol(_buffer + 1, NULL, 16);
-                            _parsedMessage.checkCrc(crcFromMsg);
+                            _reading->checkCrc(crcFromMsg);
+                            _reading->receivedMs = millis();
 
                             ESP_LOGI("crc", "Telegram read. CRC: %04X = %04X. PASS = %s", 
-                                    _parsedMessage.crc, crcFromMsg, _parsedMessage.crcOk ? "YES": "NO");
-
-                        // otherwise pass the row through the CRC calculation
-                        } 
-                        else 
-                        {
-                            for (int i = 0; i < _bufferLen; i++)
-                            {
-                                _parsedMessage.updateCrc16(_buffer[i]);
-                            }
+                                    _reading->crc, crcFromMsg, _reading->crcOk ? "YES": "NO");
                         }
 
-                        // Remove CR LF before logging and processing
-                        _buffer[_bufferLen-1] = '\0';
-                        if (_buffer[_bufferLen-2] == '\r')
-                            _buffer[_bufferLen-2] = '\0';
+                        parseAsciiLine(_buffer, _bufferLen);
 
-                        ESP_LOGV("data", "Complete line [%s] received", _buffer);
+                        // start over for the next line
+                        _bufferLen = 0;
 
-                        // if this is a row containing information
-                        if (strchr(_buffer, '(') != NULL)
+                        if (_reading->telegramComplete)
                         {
-                            char* dataId = strtok(_buffer, DELIMITERS);
-                            char* obisCode = strtok(NULL, DELIMITERS);
-
-                            // ...and this row is a data row, then parse row
-                            if (strncmp(DATA_ID, dataId, strlen(DATA_ID)) == 0)
-                            {
-                                char* value = strtok(NULL, DELIMITERS);
-                                char* unit = strtok(NULL, DELIMITERS);
-                                _parsedMessage.parseRow(obisCode, value);
-                            }
+                            completeTelegram();
                         }
-
-                        // clean buffer for next line
-                        memset(_buffer, 0, BUF_SIZE);
-                        _bufferLen = 0;
                     } 
+                    else if (_bufferLen == _bufferSize)
+                    {
+                        // Nothing more fits, the line would never complete and block the UART.
+                        // Its text, if any, is kept up to here and the rest is dropped up to
+                        // its line feed.
+                        if (!_discardLine && !parseTruncatedLine(_buffer, _bufferLen))
+                            ESP_LOGW("ascii", "Line longer than buffer_size (%d), skipping it.", (int) _bufferSize);
+                        _discardLine = true;
+                        _bufferLen = 0;
+                    }
                     else 
                     {
-                        ESP_LOGV("data", "Partial line [%s] received, busywaiting for one byte", _buffer);
-                        // if we did not get a complete line, busywait for a single byte over uart
-                        delayMicroseconds(_uSecondsPerByte);
+                        // The partial line stays in _buffer and the next call appends the rest
+                        P1_TRACE(V, TRACE_PARTIAL_LINE, _bufferLen, 0,
+                                 "data", "Partial line [%.*s] received", (int) _bufferLen, _buffer);
                     }
                 }
 
-                if ((millis() - start) > 20)
+                if (!_readBudget->stepDone(PHASE_READ))
                 {
-                    ESP_LOGD("ascii", "Waiting for the next time slice while reading message...");
+                    P1_TRACE(D, TRACE_READ_PAUSED, _rxLen - _rxPos, 0,
+                             "ascii", "Waiting for the next time slice while reading message...");
                     break;
                 }
             }
         }
 
-        bool P1Reader::readByteRepeat(uint8_t *data)
-        {
-            bool hasData = read_byte(data);
-            // Act as an active repeater: echo every byte received from the meter
-            // straight out the TX pin so a second P1 device can share the port.
-            if (hasData && _repeatToTx)
-            {
-                write_byte(*data);
-            }
-            return hasData;
-        }
-
-        size_t P1Reader::readBytesUntilAndIncluding(char terminator, char *buffer, size_t length)
+        void P1Reader::parseAsciiLine(const char *text, size_t len)
         {
-            size_t index = 0;
-            uint32_t start = millis();
-            while (index < length)
+            // Leave CR LF out of logging and processing
+            size_t lineLen = len;
+            if (lineLen > 0 && text[lineLen-1] == '\n')
+                lineLen--;
+            if (lineLen > 0 && text[lineLen-1] == '\r')
+                lineLen--;
+
+            P1_TRACE(V, TRACE_LINE, lineLen, 0, "data", "Complete line [%.*s] received", (int) lineLen, text);
+
+            // if this is a data row, parse it straight out of the buffer. Any A-B goes, which
+            // covers the M-Bus channels (0-n) and the general codes (0-0) next to 1-0.
+            AsciiLine line;
+            if (AsciiLine::tokenize(text, lineLen, &line))
             {
-                uint8_t c;
-                bool hasData = readByteRepeat(&c);
-                if (!hasData)
+                uint32_t obisKey = obisKeyFromText(line.dataId.in(text),
+                                                   line.obisCode.offset + line.obisCode.length - line.dataId.offset);
+                NumberResult result = _reading->parseRow(obisKey, line.value.in(text), line.value.length,
+                                                         _configuredSlots);
+                if (result != NUMBER_OK)
                 {
-                    break;
+                    ESP_LOGW("ascii", "Value of [%.*s] is %s, skipping it.",
+                             (int) lineLen, text, numberResultText(result));
                 }
-                *buffer++ = (char)c;
-                index++;
-                if (c == terminator)
+                if (_configuredTexts != 0)
                 {
-                    break;
+                    _reading->parseText(obisKey, line.first.in(text), line.first.length,
+                                        line.value.in(text), line.value.length, _configuredTexts);
                 }
             }
-
-            return index; // return number of characters, not including terminator
         }
 
-        uint16_t crc16_x25(byte* data, int len)
+        bool P1Reader::parseTruncatedLine(const char *text, size_t len)
         {
-            uint16_t crc = 0xffff;
-            for (int i = 0; i < len; i++)
-            {
-                crc ^= data[i];
-                for (unsigned k = 0; k < 8; k++)
-                    crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x8408 : crc >> 1;
-            }
-            return ~crc;
-        }
+            // Only text values, a number cut off anywhere would be wrong
+            AsciiLine line;
+            if (_configuredTexts == 0 || !AsciiLine::tokenize(text, len, &line, true))
+                return false;
 
-        /*  Reads messages formatted according to "Branschrekommendation v1.2", which
-            at the time of writing (20210207) is used by Tekniska Verken's Aidon 6442SE
-            meters. This is a binary format, with a HDLC Frame. 
+            uint32_t obisKey = obisKeyFromText(line.dataId.in(text),
+                                               line.obisCode.offset + line.obisCode.length - line.dataId.offset);
+            const TextEntry *entry = lookupText(obisKey);
+            if (entry == nullptr || (_configuredTexts & (1 << entry->slot)) == 0)
+                return false;
+
+            ESP_LOGD("ascii", "Line longer than buffer_size (%d), keeping its text up to there.", (int) _bufferSize);
+            _reading->parseText(obisKey, line.first.in(text), line.first.length,
+                                line.value.in(text), line.value.length, _configuredTexts);
+            return true;
+        }
 
-            This code is in no way a generic HDLC Frame parser, but it does the job
-            of decoding this particular data stream.
+        /*  Same telegrams as readP1MessageAscii, but the whole telegram from '/' through the
+            "!XXXX" line is captured into _buffer first (capture_telegram). The CRC then runs
+            over it in one pass and the lines are only parsed once it has passed, so a bad
+            telegram costs nothing but the copy.
         */
-        void P1Reader::readP1MessageHDLC() 
+        void P1Reader::readP1MessageAsciiTelegram()
         {
-            if (available())
+            _readBudget->skipStep();
+
+            // A telegram left half parsed by the last call has to be done before _buffer is reused
+            if (_captureState == CAPTURE_PARSING && !parseCapturedTelegram())
             {
-                uint8_t data = 0;
-                uint32_t start = millis();
+                return;
+            }
 
-                while (_parseHDLCState == OUTSIDE_FRAME)
+            while (stageRxBytes() > 0)
+            {
+                const char *src = (const char *) _rxChunk + _rxPos;
+                size_t staged = _rxLen - _rxPos;
+
+                if (_captureState == CAPTURE_HUNTING)
                 {
-                    bool hasData = readByteRepeat(&data);
-                    if (hasData && data == 0x7e)
+                    // Everything before the '/' that starts a telegram is skipped
+                    const char *start = (const char *) memchr(src, '/', staged);
+                    if (start == NULL)
                     {
-                        uint8_t wait = 10;
-                        while (!hasData && wait > 0)
-                        {
-                            hasData = readByteRepeat(&data);
-                            if (!hasData)
-                            {
-                                delayMicroseconds(_uSecondsPerByte);
-                                wait--;
-                            }
-                        }
+                        _rxPos = _rxLen;
+                        continue;
+                    }
 
-                        if (!hasData)
-                        {
-                            ESP_LOGD("hdlc", "Possibly found end of frame while looking for start of frame, bailing out and trying again later...");
-                        }
+                    _rxPos += start - src;
+                    _bufferLen = 0;
+                    _crcLineStart = 0;
+                    _captureState = CAPTURE_READING;
+                    continue;
+                }
 
-                        // clean buffer for next packet
-                        memset(_buffer, 0, BUF_SIZE);
-                        _bufferLen = 0;
+                size_t room = _bufferSize - _bufferLen;
+                size_t len = staged < room ? staged : room;
+                if (len == 0)
+                {
+                    ESP_LOGE("ascii", "Telegram does not fit in buffer_size (%d), skipping it.", (int) _bufferSize);
+                    _captureState = CAPTURE_HUNTING;
+                    continue;
+                }
 
-                        if (data == 0x7e)
-                        {
-                            _buffer[_bufferLen++] = data;
-                        }
-                        else
-                        {
-                            _buffer[_bufferLen++] = 0x7e;
-                            _buffer[_bufferLen++] = data;
-                        }
+                size_t from = _bufferLen;
+                memcpy(_buffer + from, src, len);
 
-                        ESP_LOGD("hdlc", "Found start of frame...");
-                        _parseHDLCState = READING_FRAME;
-                        break;
-                    }
+                if (_crcLineStart == 0)
+                {
+                    const char *bang = (const char *) memchr(_buffer + from, '!', len);
+                    if (bang != NULL)
+                        _crcLineStart = bang - _buffer;
                 }
 
-                while (_parseHDLCState == READING_FRAME)
+                // The telegram ends with the line feed after "!XXXX"
+                const char *end = NULL;
+                if (_crcLineStart != 0)
                 {
-                    bool hasData = readByteRepeat(&data);
-                    if (hasData)
-                    {
-                        _buffer[_bufferLen++] = data;
+                    size_t searchFrom = from > _crcLineStart ? from : _crcLineStart;
+                    end = (const char *) memchr(_buffer + searchFrom, '\n', from + len - searchFrom);
+                }
 
-                        if (data == 0x7e)
-                        {
-                            ESP_LOGD("hdlc", "Found end of frame...");
-                            _parseHDLCState = FOUND_FRAME;
-                            return; // Always parse in a separate timeslot
-                        }
+                if (end == NULL)
+                {
+                    _rxPos += len;
+                    _bufferLen += len;
+                }
+                else
+                {
+                    size_t used = end - _buffer + 1 - from;
+                    _rxPos += used;
+                    _bufferLen += used;
 
-                        if (_bufferLen >= BUF_SIZE)
-                        {
-                            _parseHDLCState = OUTSIDE_FRAME;
-                            ESP_LOGE("hdlc", "Failed to read frame, buffer overflow, bailing out...");
-                            return;
-                        }
-                    }
-                    else
+                    if (checkCapturedTelegram() && !parseCapturedTelegram())
                     {
-                        // No byte available, busywait for a single byte over uart
-                        delayMicroseconds(_uSecondsPerByte);
-                        if ((millis() - start) > 10)
-                        {
-                            ESP_LOGD("hdlc", "Failed to fetch expected data within 10ms, bailing out and trying later.");
-                            return;
-                        }
+                        return;
                     }
                 }
-            }
-            
-            if (_parseHDLCState == FOUND_FRAME)
-            {
-                if (_bufferLen < 17)
-                {
-                    _parseHDLCState = OUTSIDE_FRAME;
-                    ESP_LOGE("hdlc", "Frame to small, skipping to next frame. (%d)", _bufferLen);
-                    return;
-                }
 
-                uint16_t messageLength = ((_buffer[1] & 0x0f) << 8) + (uint8_t)_buffer[2];
-                if (messageLength != (_bufferLen - 2))
+                if (!_readBudget->stepDone(PHASE_READ))
                 {
-                    _parseHDLCState = OUTSIDE_FRAME;
-                    ESP_LOGE("hdlc", "Message length (%d) not matching frame length (%d), skipping to next frame.", 
-                            messageLength, _bufferLen-2);
-                    return;
+                    P1_TRACE(D, TRACE_READ_PAUSED, _rxLen - _rxPos, 0,
+                             "ascii", "Waiting for the next time slice while reading message...");
+                    break;
                 }
+            }
+        }
 
-                uint16_t crc = ((uint8_t)_buffer[_bufferLen-2] << 8) | (uint8_t)_buffer[_bufferLen-3];
-                uint16_t crcCalculated = crc16_x25((byte*)_buffer + 1, _bufferLen - 4); // FCS
-                if (crc != crcCalculated)
-                {
-                    _parseHDLCState = OUTSIDE_FRAME;
-                    ESP_LOGE("hdlc", "Message crc (%04x) not matching frame crc (%04x), skipping to next frame.", 
-                            crc, crcCalculated);
-                    return;
-                }
+        bool P1Reader::checkCapturedTelegram()
+        {
+            // The CRC covers everything up to and including the '!'
+            _reading->crc = crc16Update(CRC16_ARC, 0, (const uint8_t *) _buffer, _crcLineStart + 1);
+            int crcFromMsg = (int) strtol(_buffer + _crcLineStart + 1, NULL, 16);
+            _reading->checkCrc(crcFromMsg);
+            _reading->receivedMs = millis();
 
-                _parsedMessage.crcOk = true;
+            ESP_LOGI("crc", "Telegram read. CRC: %04X = %04X. PASS = %s", 
+                    _reading->crc, crcFromMsg, _reading->crcOk ? "YES": "NO");
 
-                _messagePos = 17;
+            if (!_reading->crcOk)
+            {
+                completeTelegram();
+                _captureState = CAPTURE_HUNTING;
+                return false;
+            }
 
-                // Skip date field (normally 0)
-                _messagePos += _buffer[_messagePos++];
+            _capturePos = 0;
+            _captureState = CAPTURE_PARSING;
+            return true;
+        }
 
-                // Check for start of struct array
-                if (_buffer[_messagePos++] != 0x01)
-                {
-                    _parseHDLCState = OUTSIDE_FRAME;
-                    ESP_LOGE("hdlc", "Message array start tag (0x01) missing, got (%x), skipping to next frame.", 
-                            _buffer[_messagePos-1]);
-                    return;
-                }
+        bool P1Reader::parseCapturedTelegram()
+        {
+            while (_capturePos < _crcLineStart)
+            {
+                const char *line = _buffer + _capturePos;
+                const char *lf = (const char *) memchr(line, '\n', _crcLineStart - _capturePos);
+                uint16_t next = lf != NULL ? lf - _buffer + 1 : _crcLineStart;
 
-                uint8_t structCount = _buffer[_messagePos++];
-                ESP_LOGD("hdlc", "Number of structs are %d", structCount);
+                parseAsciiLine(line, next - _capturePos);
+                _capturePos = next;
 
-                for (int i=0; i<structCount; i++) 
+                if (_capturePos < _crcLineStart && !_readBudget->stepDone(PHASE_READ))
                 {
-                    if (!parseHDLCStruct())
-                    {
-                        _parseHDLCState = OUTSIDE_FRAME;
-                        ESP_LOGE("hdlc", "Failed to parse structs");
-                        return;
-                    }
+                    P1_TRACE(D, TRACE_PARSE_PAUSED, _capturePos, 0,
+                             "ascii", "Waiting for the next time slice while parsing message...");
+                    return false;
                 }
-
-                _parsedMessage.telegramComplete = true;
             }
+
+            completeTelegram();
+            _captureState = CAPTURE_HUNTING;
+            return true;
         }
 
-        bool P1Reader::parseHDLCStruct()
+        size_t P1Reader::stageRxBytes()
         {
-            char obis[7];
-            memset(obis, 0, 7);
-            bool is_signed = false;
-            double scaleFactors[10] = { 0.0001, 0.001, 0.01, 0.1, 1.0,
-                                        10.0, 100.0, 1000.0,
-                                        10000.0, 100000.0 };
-            int8_t scale = 0;
-            int32_t value = 0;
-            uint32_t uvalue = 0xffffffff;
-
-            // Check for start of struct
-            if (_buffer[_messagePos++] != 0x02)
-            {
-                _parseHDLCState = OUTSIDE_FRAME;
-                ESP_LOGE("hdlc", "Message struct start tag (0x02) missing, got (%x), skipping to next frame.", 
-                        _buffer[_messagePos-1]);
-                return false;
+            if (_rxPos < _rxLen)
+            {
+                return _rxLen - _rxPos;
             }
 
-            uint8_t structElements = _buffer[_messagePos++];
-            ESP_LOGV("hdlc", "Number of struct elements are %d", structElements);
+            int avail = available();
+            if (avail <= 0)
+            {
+                return 0;
+            }
+            _diag.noteAvailable(avail);
+
+            // Pull everything the UART has (up to the staging size) in one go rather
+            // than paying for a read_byte call per byte
+            size_t len = avail < (int) RX_CHUNK_SIZE ? avail : RX_CHUNK_SIZE;
+            if (!read_array(_rxChunk, len))
+            {
+                return 0;
+            }
 
-            for (int i=0; i<structElements; i++) 
+            // Act as an active repeater: echo every byte received from the meter
+            // straight out the TX pin so a second P1 device can share the port.
+            if (_repeatToTx)
             {
-                if (_messagePos >= _bufferLen)
+                write_array(_rxChunk, len);
+            }
+
+            _rxPos = 0;
+            _rxLen = len;
+            return len;
+        }
+
+        size_t P1Reader::readBytesUntilAndIncluding(char terminator, char *buffer, size_t length)
+        {
+            size_t index = 0;
+            while (index < length)
+            {
+                size_t staged = stageRxBytes();
+                if (staged == 0)
                 {
-                    _parseHDLCState = OUTSIDE_FRAME;
-                    ESP_LOGE("hdlc", "Reading (%d) past end of message (%d).", 
-                            _messagePos, _bufferLen);
-                    return false;
+                    break;
                 }
 
-                uint8_t tag = _buffer[_messagePos++];
-                switch (tag)
+                const uint8_t *src = _rxChunk + _rxPos;
+                size_t len = staged < length - index ? staged : length - index;
+                const uint8_t *found = (const uint8_t *) memchr(src, terminator, len);
+                if (found != NULL)
                 {
-                    case 0x02: 
-                        {
-                            // another inner struct
-                            uint8_t innerStructElements = _buffer[_messagePos++];
-                            ESP_LOGV("hdlc", "Number of inner struct elements are %d", innerStructElements);
-
-                            for (int j=0; j<innerStructElements; j++) 
-                            {
-                                uint8_t innerTag = _buffer[_messagePos++];
-                                switch (innerTag)
-                                {
-                                    case 0x0f:
-                                        scale = _buffer[_messagePos++]; // 10E(scale)
-                                        break;
-                                    case 0x16: 
-                                    {
-                                        // Unit
-                                        // 0x1b: (k)W
-                                        // 0x1d: (k)VAr
-                                        // 0x1e: (k)Wh
-                                        // 0x20: (k)VArh
-                                        // 0x21: A
-                                        // 0x23: V
-                                        uint8_t unit = _buffer[_messagePos++];
-                                        if (scale == 0 && unit != 0x21 && unit != 0x23)
-                                            scale = -3; // ref KILO in sensor.py
-                                        break;
-                                    }
-                                    default:
-                                        ESP_LOGE("hdlc", "Unknown tag encountered (%x)", innerTag);
-                                        break;
-                                }
-                            }
-                            break;
-                        }
-                    case 0x06:
-                        uvalue = (uint8_t)_buffer[_messagePos + 3] | 
-                                ((uint8_t)_buffer[_messagePos + 2] << 8) | 
-                                ((uint8_t)_buffer[_messagePos + 1] << 16) | 
-                                ((uint8_t)_buffer[_messagePos] << 24);
-                        _messagePos += 4;
-                        break;
-                    case 0x09:
-                        {
-                            uint8_t rowLen = _buffer[_messagePos++];
-                            if (rowLen == 6)
-                            {
-                                // Map to string for ascii parser
-                                if (_buffer[_messagePos + 2] > 9)
-                                {
-                                    obis[0] = (_buffer[_messagePos + 2] / 10) + 48;
-                                    obis[1] = (_buffer[_messagePos + 2] % 10) + 48;
-                                    obis[3] = _buffer[_messagePos + 3] + 48;
-                                    obis[5] = _buffer[_messagePos + 4] + 48;
-                                    obis[2] = obis[4] = '.';
-                                }
-                                else
-                                {
-                                    obis[0] = _buffer[_messagePos + 2] + 48;
-                                    obis[2] = _buffer[_messagePos + 3] + 48;
-                                    obis[4] = _buffer[_messagePos + 4] + 48;
-                                    obis[1] = obis[3] = '.';
-                                }
-                            }
-                            _messagePos += rowLen;
-                            break;
-                        }
-                    case 0x10:
-                        // Signed 16-bit. Mask both bytes to avoid signed-char sign
-                        // extension polluting the upper bits, then cast to recover sign.
-                        value = (int16_t)(((uint8_t)_buffer[_messagePos + 0] << 8) | (uint8_t)_buffer[_messagePos + 1]);
-                        _messagePos += 2;
-                        break;
-                    case 0x12:
-                        value = (int16_t)(((uint8_t)_buffer[_messagePos + 0] << 8) | (uint8_t)_buffer[_messagePos + 1]);
-                        _messagePos += 2;
-                        break;
-                    default:
-                        ESP_LOGE("hdlc", "Unknown tag encountered (%x)", tag);
-                        break;
+                    len = found - src + 1;
+                }
+
+                memcpy(buffer + index, src, len);
+                _rxPos += len;
+                index += len;
+
+                if (found != NULL)
+                {
+                    break;
                 }
             }
 
-            if (obis[0] == '\0')
+            // Fold the chunk into the telegram CRC while it is at hand, so the
+            // line never has to be walked again just for the CRC
+            _reading->updateCrc16(buffer, index);
+
+            return index; // return number of characters, not including terminator
+        }
+
+        /*  Reads messages formatted according to "Branschrekommendation v1.2", which
+            at the time of writing (20210207) is used by Tekniska Verken's Aidon 6442SE
+            meters. This is a binary format, with a HDLC Frame. 
+
+            The frame is decoded as it comes in by HdlcDecoder, see hdlc_decoder.h.
+        */
+        void P1Reader::readP1MessageHDLC() 
+        {
+            if (stageRxBytes() == 0)
             {
-                ESP_LOGV("hdlc", "No data found in struct.");
-                return true;
+                return;
             }
 
-            double scaledValue;
-            
-            if (uvalue == 0xffffffff)
-                scaledValue = scaleFactors[scale + 4] * value;
-            else
-                scaledValue = scaleFactors[scale + 4] * uvalue;
+            uint32_t now = millis();
+            if (_hdlc.inFrame() && now - _lastRxMs > _frameTimeoutMs)
+            {
+                ESP_LOGE("hdlc", "No data for %u ms in the middle of a frame, skipping to next frame.", 
+                        (unsigned) (now - _lastRxMs));
+                _hdlc.reset();
+                Diagnostics::count(_diag.frameErrors);
+            }
+            _lastRxMs = now;
 
-            ESP_LOGD("hdlc", "VAL %s, %f, %d\n", obis, scaledValue, scale);
+            _readBudget->skipStep();
+            while (stageRxBytes() > 0)
+            {
+                size_t consumed = 0;
+                HdlcDecoder::Result result = _hdlc.feed(_rxChunk + _rxPos, _rxLen - _rxPos, _configuredSlots, &consumed);
+                _rxPos += consumed;
 
-            _parsedMessage.parseRow(obis, scaledValue);
+                if (result == HdlcDecoder::FRAME_OK)
+                {
+                    _hdlc.commit(_reading);
+                    _reading->crc = _hdlc.fcs();
+                    _reading->crcOk = true;
+                    _reading->telegramComplete = true;
+                    _reading->receivedMs = millis();
+                    P1_TRACE(D, TRACE_FRAME_READ, _reading->crc, 0, "hdlc", "Frame read. FCS: %04X", _reading->crc);
+                    completeTelegram();
+                }
+                else if (result == HdlcDecoder::CRC_ERROR)
+                {
+                    Diagnostics::count(_diag.crcFailures);
+                }
+                else if (result == HdlcDecoder::FRAME_ERROR)
+                {
+                    Diagnostics::count(_diag.frameErrors);
+                }
 
-            return true;
+                if (!_readBudget->stepDone(PHASE_READ))
+                {
+                    P1_TRACE(D, TRACE_READ_PAUSED, _rxLen - _rxPos, 0,
+                             "hdlc", "Waiting for the next time slice while reading frame...");
+                    return;
+                }
+            }
         }
     }
 }
@@ -25,9 +25,23 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
 #include "esphome/components/uart/uart.h"
 #include "esphome/components/sensor/sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
+#include "ascii_line.h"
+#include "diagnostics.h"
+#include "hdlc_decoder.h"
 #include "parsed_message.h"
+#include "publish_filter.h"
+#include "spsc_queue.h"
+#include "time_budget.h"
+#include "trace.h"
+
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 namespace esphome
 {
@@ -43,7 +57,18 @@ namespace esphome
             {}
 
             void setup() override;
+            void loop() override;
             void update() override;
+
+            // Logs the events recorded with trace: ring, e.g. from a button's lambda
+            void dump_trace()
+            {
+#ifdef P1READER_TRACE_RING
+                traceRing.dump();
+#else
+                ESP_LOGW("trace", "Nothing recorded, set trace: ring to record events");
+#endif
+            }
         protected:
             float get_setup_priority() const override { return esphome::setup_priority::LATE; }
 
@@ -54,10 +79,63 @@ namespace esphome
             // so a second P1 device can share the port (see set_repeat_to_tx).
             bool _repeatToTx{false};
 
-            ParsedMessage _parsedMessage = ParsedMessage();
-            char _buffer[BUF_SIZE];
-            uint16_t _bufferLen;
-            int _uSecondsPerByte;
+            // When true, the meter is read from loop() as soon as data arrives and the
+            // poller is disabled (see set_read_mode)
+            bool _loopMode{false};
+            // available() as seen by the previous loop(), to tell a line still coming
+            // in from one that has gone quiet
+            int _lastAvailable{0};
+            // In loop mode, read once this many bytes are waiting (or the line is quiet)
+            static const int LOOP_WAKE_BYTES = 64;
+            // Keeps loop() running flat out from the first byte of a telegram until it is published
+            HighFrequencyLoopRequester _highFrequencyLoop;
+            // One update() worth of work, called by update() or by loop() in loop mode
+            void readAndPublish();
+
+            // Limits the time spent in one update() call, see set_time_budget
+            TimeBudget _timeBudget;
+            // Budget the read functions work against, the reader task keeps its own
+            TimeBudget *_readBudget{&_timeBudget};
+
+            // When true, a task of its own reads and parses the meter and loop() only
+            // publishes (ESP32 only, see set_reader_task)
+            bool _readerTaskMode{false};
+            // Telegrams that passed their CRC in the reader task, waiting to be published
+            SpscQueue<ParsedMessage, 4> _telegramQueue;
+            void publishQueuedTelegram();
+#ifdef USE_ESP32
+            static const uint32_t READER_TASK_STACK = 4096;
+            static const UBaseType_t READER_TASK_PRIORITY = 2;  // just above the Arduino loop task
+            static const BaseType_t READER_TASK_CORE = 1;
+
+            TimeBudget _taskBudget;
+            TaskHandle_t _readerTask{nullptr};
+            TickType_t _readerTaskDelay{1};  // sleep while the UART is quiet
+            static void readerTask(void *param);
+#endif
+
+            // Slots that have a sensor and the sensor of each slot, built in setup
+            SlotMask _configuredSlots{0};
+            sensor::Sensor *_slotSensors[SLOT_COUNT];
+            uint32_t _telegramsPublished{0};
+
+            // The reader fills one message while the other one is being published, they
+            // trade places when a telegram passes its CRC (see completeTelegram)
+            ParsedMessage _messages[2];
+            ParsedMessage *_reading{&_messages[0]};
+            ParsedMessage *_publishing{nullptr};
+            // Allocated in setup(), only for ASCII
+            char *_buffer{nullptr};
+            uint16_t _bufferSize{60};
+            uint16_t _bufferLen{0};
+            // The line in _buffer didn't fit, drop the rest of it up to the next line feed
+            bool _discardLine{false};
+
+            // Staging area for bulk reads from the UART, see stageRxBytes
+            static const size_t RX_CHUNK_SIZE = 128;
+            uint8_t _rxChunk[RX_CHUNK_SIZE];
+            uint16_t _rxPos{0};
+            uint16_t _rxLen{0};
 
             sensor::Sensor *cumulative_active_import{nullptr};
             sensor::Sensor *cumulative_active_export{nullptr};
@@ -65,6 +143,16 @@ namespace esphome
             sensor::Sensor *cumulative_reactive_import{nullptr};
             sensor::Sensor *cumulative_reactive_export{nullptr};
 
+            sensor::Sensor *cumulative_active_import_t1{nullptr};
+            sensor::Sensor *cumulative_active_import_t2{nullptr};
+            sensor::Sensor *cumulative_active_export_t1{nullptr};
+            sensor::Sensor *cumulative_active_export_t2{nullptr};
+
+            sensor::Sensor *mbus_1_reading{nullptr};
+            sensor::Sensor *mbus_2_reading{nullptr};
+            sensor::Sensor *mbus_3_reading{nullptr};
+            sensor::Sensor *mbus_4_reading{nullptr};
+
             sensor::Sensor *momentary_active_import{nullptr};
             sensor::Sensor *momentary_active_export{nullptr};
 
@@ -97,31 +185,86 @@ namespace esphome
             sensor::Sensor *current_l2{nullptr};
             sensor::Sensor *current_l3{nullptr};
 
+            sensor::Sensor *tariff{nullptr};
+            sensor::Sensor *power_failures{nullptr};
+            sensor::Sensor *long_power_failures{nullptr};
+
+            sensor::Sensor *voltage_sags_l1{nullptr};
+            sensor::Sensor *voltage_sags_l2{nullptr};
+            sensor::Sensor *voltage_sags_l3{nullptr};
+            sensor::Sensor *voltage_swells_l1{nullptr};
+            sensor::Sensor *voltage_swells_l2{nullptr};
+            sensor::Sensor *voltage_swells_l3{nullptr};
+
+            // Text sensors per text slot, and the slots that have one
+            text_sensor::TextSensor *_textSensors[TEXT_SLOT_COUNT]{};
+            TextMask _configuredTexts{0};
+
+            // deadband / max_interval state per slot, see set_publish_filter
+            PublishFilter _publishFilters[SLOT_COUNT];
+
+            // Diagnostic sensors, published every DIAGNOSTICS_INTERVAL_MS when any is configured
+            static const uint32_t DIAGNOSTICS_INTERVAL_MS = 60000;
+            Diagnostics _diag;
+            uint32_t _diagLastPublished{0};  // _telegramsPublished at the last publish
+            sensor::Sensor *_diagTelegramsPerMinute{nullptr};
+            sensor::Sensor *_diagCrcFailures{nullptr};
+            sensor::Sensor *_diagFrameErrors{nullptr};
+            sensor::Sensor *_diagMaxUpdateTime{nullptr};
+            sensor::Sensor *_diagPublishLatency{nullptr};
+            sensor::Sensor *_diagUartHighWater{nullptr};
+
+            void publishDiagnostics();
+
+            void completeTelegram();
             void publishSensors(ParsedMessage* parsedMessage);
+            void publishSlot(uint8_t slot, ParsedMessage* parsedMessage, uint32_t now);
+            void publishText(uint8_t textSlot, ParsedMessage* parsedMessage);
 
             // ASCII
-            const char* DELIMITERS = "()*:";
-            const char* DATA_ID = "1-0";
-
             size_t readBytesUntilAndIncluding(char terminator, char *buffer, size_t length);
+            void parseAsciiLine(const char *text, size_t len);
+            // The start of a line that didn't fit in _buffer, true when it held a configured text
+            bool parseTruncatedLine(const char *text, size_t len);
 
-            // Reads a single byte from the meter, echoing it out the TX pin when
-            // repeater mode is enabled. Returns false when no byte was available.
-            bool readByteRepeat(uint8_t *data);
+            // capture_telegram: the whole telegram is read into _buffer before any of it is parsed
+            static const uint8_t CAPTURE_HUNTING = 0;  // waiting for the '/' of a telegram
+            static const uint8_t CAPTURE_READING = 1;
+            static const uint8_t CAPTURE_PARSING = 2;  // CRC passed, lines being parsed
+
+            bool _captureTelegram{false};
+            uint8_t _captureState{CAPTURE_HUNTING};
+            uint16_t _crcLineStart{0};  // offset of the '!' in _buffer once it has been read
+            uint16_t _capturePos{0};    // next line to parse
+
+            bool checkCapturedTelegram();
+            bool parseCapturedTelegram();
+
+            // Returns the number of bytes waiting in _rxChunk. When it is empty, everything
+            // the UART has (up to RX_CHUNK_SIZE) is pulled in with a single read_array and
+            // echoed out the TX pin when repeater mode is enabled.
+            size_t stageRxBytes();
 
             // HLDC
-            const int8_t OUTSIDE_FRAME = 0;
-            const int8_t READING_FRAME = 2;
-            const int8_t FOUND_FRAME = 2;
-            
-            int8_t _parseHDLCState = OUTSIDE_FRAME;
-            uint16_t _messagePos;
-            
-            bool parseHDLCStruct();
+            HdlcDecoder _hdlc;
+            // Meters send a frame in one go. A frame that stalls for longer than this has lost
+            // bytes, and as frames are delimited by their length it would eat into the next one.
+            uint32_t _frameTimeoutMs{100};
+            uint32_t _lastRxMs{0};
+
+            // Keys for ciphered HDLC messages, handed to _hdlc in setup()
+            uint8_t _decryptionKey[GcmDecryptor::KEY_LEN];
+            uint8_t _authenticationKey[GcmDecryptor::KEY_LEN];
+            bool _hasDecryptionKey{false};
+            bool _hasAuthenticationKey{false};
+
+            // 32 hex digits to a key, false if it isn't that
+            static bool parseKey(const std::string &hex, uint8_t *key);
 
             // Message read abstraction
             void (P1Reader::*readP1Message)(){nullptr};
             void readP1MessageAscii();
+            void readP1MessageAsciiTelegram();
             void readP1MessageHDLC();
 
         public:
@@ -136,11 +279,66 @@ namespace esphome
                 ESP_LOGI("setup", "Protocol is %s", protocol.c_str());
             }
 
+            // "polling" reads on a fixed interval worked out from rx_buffer_size, "loop"
+            // reads from loop() whenever data is waiting
+            void set_read_mode(std::string mode)
+            {
+                _loopMode = mode == "loop";
+            }
+
+            // Longest a single update() call should take. Each call stops before the next
+            // step (a line, a frame or a publish) that would take it over this.
+            void set_time_budget(uint32_t budgetMs)
+            {
+                _timeBudget.setBudgetUs(budgetMs * 1000);
+#ifdef USE_ESP32
+                _taskBudget.setBudgetUs(budgetMs * 1000);
+#endif
+            }
+
+            // Read and parse in a FreeRTOS task pinned to core 1, publish from loop()
+            void set_reader_task(bool enabled)
+            {
+                _readerTaskMode = enabled;
+            }
+
+            // Read whole ASCII telegrams into the buffer and check the CRC before parsing them,
+            // buffer_size has to fit the longest telegram the meter sends
+            void set_capture_telegram(bool enabled)
+            {
+                _captureTelegram = enabled;
+            }
+
+            // Size of the ASCII line buffer, or of the whole telegram with capture_telegram
+            void set_buffer_size(uint16_t size)
+            {
+                _bufferSize = size;
+            }
+
+            // AES-128 keys for ciphered HDLC messages, 32 hex digits each. The authentication
+            // key is optional, without one the tag of a message isn't checked.
+            void set_decryption_key(const std::string &hex)
+            {
+                _hasDecryptionKey = parseKey(hex, _decryptionKey);
+            }
+
+            void set_authentication_key(const std::string &hex)
+            {
+                _hasAuthenticationKey = parseKey(hex, _authenticationKey);
+            }
+
             void set_repeat_to_tx(bool enabled)
             {
                 _repeatToTx = enabled;
             }
 
+            // Only publish the slot when it moved more than deadband (milli-units, or hundredths
+            // of a percent when percent is set) or when maxIntervalMs (0 = never) has passed
+            void set_publish_filter(uint8_t slot, int32_t deadband, bool percent, uint32_t maxIntervalMs)
+            {
+                _publishFilters[slot].configure(deadband, percent, maxIntervalMs);
+            }
+
             void set_sensor_cumulative_active_import(sensor::Sensor *sensor)
             {
                 cumulative_active_import = sensor;
@@ -159,6 +357,39 @@ namespace esphome
                 cumulative_reactive_export = sensor;
             }
 
+            void set_sensor_cumulative_active_import_t1(sensor::Sensor *sensor)
+            {
+                cumulative_active_import_t1 = sensor;
+            }
+            void set_sensor_cumulative_active_import_t2(sensor::Sensor *sensor)
+            {
+                cumulative_active_import_t2 = sensor;
+            }
+            void set_sensor_cumulative_active_export_t1(sensor::Sensor *sensor)
+            {
+                cumulative_active_export_t1 = sensor;
+            }
+            void set_sensor_cumulative_active_export_t2(sensor::Sensor *sensor)
+            {
+                cumulative_active_export_t2 = sensor;
+            }
+            void set_sensor_mbus_1_reading(sensor::Sensor *sensor)
+            {
+                mbus_1_reading = sensor;
+            }
+            void set_sensor_mbus_2_reading(sensor::Sensor *sensor)
+            {
+                mbus_2_reading = sensor;
+            }
+            void set_sensor_mbus_3_reading(sensor::Sensor *sensor)
+            {
+                mbus_3_reading = sensor;
+            }
+            void set_sensor_mbus_4_reading(sensor::Sensor *sensor)
+            {
+                mbus_4_reading = sensor;
+            }
+
             void set_sensor_momentary_active_import(sensor::Sensor *sensor)
             {
                 momentary_active_import = sensor;
@@ -256,6 +487,106 @@ namespace esphome
             {
                 current_l3 = sensor;
             }
+
+            void set_sensor_tariff(sensor::Sensor* sensor)
+            {
+                tariff = sensor;
+            }
+            void set_sensor_power_failures(sensor::Sensor* sensor)
+            {
+                power_failures = sensor;
+            }
+            void set_sensor_long_power_failures(sensor::Sensor* sensor)
+            {
+                long_power_failures = sensor;
+            }
+            void set_sensor_voltage_sags_l1(sensor::Sensor* sensor)
+            {
+                voltage_sags_l1 = sensor;
+            }
+            void set_sensor_voltage_sags_l2(sensor::Sensor* sensor)
+            {
+                voltage_sags_l2 = sensor;
+            }
+            void set_sensor_voltage_sags_l3(sensor::Sensor* sensor)
+            {
+                voltage_sags_l3 = sensor;
+            }
+            void set_sensor_voltage_swells_l1(sensor::Sensor* sensor)
+            {
+                voltage_swells_l1 = sensor;
+            }
+            void set_sensor_voltage_swells_l2(sensor::Sensor* sensor)
+            {
+                voltage_swells_l2 = sensor;
+            }
+            void set_sensor_voltage_swells_l3(sensor::Sensor* sensor)
+            {
+                voltage_swells_l3 = sensor;
+            }
+
+            void set_text_sensor_timestamp(text_sensor::TextSensor* sensor)
+            {
+                _textSensors[TEXT_TIMESTAMP] = sensor;
+            }
+            void set_text_sensor_equipment_id(text_sensor::TextSensor* sensor)
+            {
+                _textSensors[TEXT_EQUIPMENT_ID] = sensor;
+            }
+            void set_text_sensor_dsmr_version(text_sensor::TextSensor* sensor)
+            {
+                _textSensors[TEXT_DSMR_VERSION] = sensor;
+            }
+            void set_text_sensor_message(text_sensor::TextSensor* sensor)
+            {
+                _textSensors[TEXT_MESSAGE] = sensor;
+            }
+            void set_text_sensor_mbus_1_timestamp(text_sensor::TextSensor* sensor)
+            {
+                _textSensors[TEXT_MBUS_1_TIMESTAMP] = sensor;
+            }
+            void set_text_sensor_mbus_2_timestamp(text_sensor::TextSensor* sensor)
+            {
+                _textSensors[TEXT_MBUS_2_TIMESTAMP] = sensor;
+            }
+            void set_text_sensor_mbus_3_timestamp(text_sensor::TextSensor* sensor)
+            {
+                _textSensors[TEXT_MBUS_3_TIMESTAMP] = sensor;
+            }
+            void set_text_sensor_mbus_4_timestamp(text_sensor::TextSensor* sensor)
+            {
+                _textSensors[TEXT_MBUS_4_TIMESTAMP] = sensor;
+            }
+
+            void set_diagnostic_telegrams_per_minute(sensor::Sensor* sensor)
+            {
+                _diagTelegramsPerMinute = sensor;
+            }
+
+            void set_diagnostic_crc_failures(sensor::Sensor* sensor)
+            {
+                _diagCrcFailures = sensor;
+            }
+
+            void set_diagnostic_frame_errors(sensor::Sensor* sensor)
+            {
+                _diagFrameErrors = sensor;
+            }
+
+            void set_diagnostic_max_update_time(sensor::Sensor* sensor)
+            {
+                _diagMaxUpdateTime = sensor;
+            }
+
+            void set_diagnostic_publish_latency(sensor::Sensor* sensor)
+            {
+                _diagPublishLatency = sensor;
+            }
+
+            void set_diagnostic_uart_high_water(sensor::Sensor* sensor)
+            {
+                _diagUartHighWater = sensor;
+            }
         };
     }
 }
@@ -1,262 +1,171 @@
 #pragma once
 
+#include <cstring>
+
+#include "crc16.h"
+#include "fixed_point.h"
+#include "obis_table.h"
+
 namespace esphome
 {
     namespace p1_reader
     {
+        // All values are kept in milli-units of what the sensors publish (kWh, kW, V, A...),
+        // which covers the 3 decimals of the spec without any floating point in the parsers.
+        // Only the cumulative registers can go past what fits in 32 bits.
         class ParsedMessage {
         public:
-            double cumulativeActiveImport;
-            double cumulativeActiveExport;
-
-            double cumulativeReactiveImport;
-            double cumulativeReactiveExport;
-
-            double momentaryActiveImport;
-            double momentaryActiveExport;
-
-            double momentaryReactiveImport;
-            double momentaryReactiveExport;
-
-            double momentaryActiveImportL1;
-            double momentaryActiveExportL1;
-
-            double momentaryActiveImportL2;
-            double momentaryActiveExportL2;
-
-            double momentaryActiveImportL3;
-            double momentaryActiveExportL3;
-
-            double momentaryReactiveImportL1;
-            double momentaryReactiveExportL1;
-
-            double momentaryReactiveImportL2;
-            double momentaryReactiveExportL2;
-
-            double momentaryReactiveImportL3;
-            double momentaryReactiveExportL3;
-
-            double voltageL1;
-            double voltageL2;
-            double voltageL3;
-
-            double currentL1;
-            double currentL2;
-            double currentL3;
+            int64_t cumulative[CUMULATIVE_SLOTS];
+            int32_t momentary[SLOT_COUNT - CUMULATIVE_SLOTS];
 
             uint16_t crc;
+            bool crcClosed;
             bool telegramComplete;
             bool crcOk;
-            uint8_t sensorsToSend;
-
-            void parseRow(const char* obisCode, const char* value)
+            // millis() when the end of the telegram was read
+            uint32_t receivedMs;
+            // Slots written by this telegram that are still to be published
+            SlotMask sensorsToSend;
+
+            // Text values, each slot at textOffset() and cut off at TEXT_CAPACITY, not terminated
+            char texts[TEXT_BUFFER_LEN];
+            uint8_t textLen[TEXT_SLOT_COUNT];
+            TextMask textsToSend;
+
+            // Only slots in wanted are parsed, the value of anything else is never looked at.
+            // A value that doesn't parse leaves its slot as it was and is not published.
+            NumberResult parseRow(uint32_t obisKey, const char* value, size_t valueLen, SlotMask wanted)
             {
-                double obisValue = simpleatof(value);
-
-                parseRow(obisCode, obisValue);
+                int8_t slot = lookupObis(obisKey);
+                if (slot == NO_SLOT || (wanted & slotBit(slot)) == 0)
+                    return NUMBER_OK;
+
+                int64_t milli;
+                NumberResult result = parseMilli(value, valueLen, &milli);
+                if (result == NUMBER_OK)
+                    result = setValue(slot, milli);
+                return result;
             }
 
-            void parseRow(const char* obisCode, double obisValue)
+            // Text counterpart of parseRow, first and last are the first and last (...) of the line
+            void parseText(uint32_t obisKey, const char* first, size_t firstLen,
+                           const char* last, size_t lastLen, TextMask wanted)
             {
-                int obisCodeLen = strnlen(obisCode, 7);
-                
-                if (obisCode[obisCodeLen-1] == '0' &&
-                    obisCode[obisCodeLen-2] == '.' &&
-                    obisCode[obisCodeLen-4] == '.')
+                const TextEntry *entry = lookupText(obisKey);
+                if (entry == nullptr || (wanted & (1 << entry->slot)) == 0)
+                    return;
+
+                const char *from = entry->first ? first : last;
+                size_t len = entry->first ? firstLen : lastLen;
+                char *to = texts + textOffset(entry->slot);
+                uint8_t capacity = TEXT_CAPACITY[entry->slot];
+                uint8_t n = 0;
+
+                if (entry->hex)
                 {
-                    switch (obisCodeLen)
+                    for (size_t i = 0; i + 1 < len && n < capacity; i += 2)
                     {
-                        case 5: switch(obisCode[obisCodeLen-3])
-                        {
-                            case '7': switch (obisCode[0])
-                            {
-                                case '1': 
-                                    momentaryActiveImport = obisValue;
-                                    break;
-                                case '2': 
-                                    momentaryActiveExport = obisValue;
-                                    break;
-                                case '3': 
-                                    momentaryReactiveImport = obisValue;
-                                    break;
-                                case '4': 
-                                    momentaryReactiveExport = obisValue;
-                                    break;
-                                default: break;
-                            }
+                        int high = hexDigit(from[i]);
+                        int low = hexDigit(from[i + 1]);
+                        if (high < 0 || low < 0)
                             break;
-                            case '8': switch (obisCode[0])
-                            {
-                                case '1': 
-                                    cumulativeActiveImport = obisValue;
-                                    break;
-                                case '2': 
-                                    cumulativeActiveExport = obisValue;
-                                    break;
-                                case '3': 
-                                    cumulativeReactiveImport = obisValue;
-                                    break;
-                                case '4': 
-                                    cumulativeReactiveExport = obisValue;
-                                    break;
-                                default: break;
-                            }
-                            break;
-                            default: break;
-                        }
-                        break;
-                        case 6: if (obisCode[obisCodeLen-3] == '7') {
-                            switch(obisCode[1]) {
-                                case '1': switch (obisCode[0])
-                                {
-                                    case '2': 
-                                        momentaryActiveImportL1 = obisValue;
-                                        break;
-                                    case '3': 
-                                        currentL1 = obisValue;
-                                        break;
-                                    case '4': 
-                                        momentaryActiveImportL2 = obisValue;
-                                        break;
-                                    case '5': 
-                                        currentL2 = obisValue;
-                                        break;
-                                    case '6': 
-                                        momentaryActiveImportL3 = obisValue;
-                                        break;
-                                    case '7': 
-                                        currentL3 = obisValue;
-                                        break;
-                                    default: break;
-                                }
-                                break;
-                                case '2': switch (obisCode[0])
-                                {
-                                    case '2': 
-                                        momentaryActiveExportL1 = obisValue;
-                                        break;
-                                    case '3': 
-                                        voltageL1 = obisValue;
-                                        break;
-                                    case '4': 
-                                        momentaryActiveExportL2 = obisValue;
-                                        break;
-                                    case '5': 
-                                        voltageL2 = obisValue;
-                                        break;
-                                    case '6': 
-                                        momentaryActiveExportL3 = obisValue;
-                                        break;
-                                    case '7': 
-                                        voltageL3 = obisValue;
-                                        break;
-                                    default: break;
-                                }
-                                break;
-                                case '3': switch (obisCode[0])
-                                {
-                                    case '2': 
-                                        momentaryReactiveImportL1 = obisValue;
-                                        break;
-                                    case '4': 
-                                        momentaryReactiveImportL2 = obisValue;
-                                        break;
-                                    case '6': 
-                                        momentaryReactiveImportL3 = obisValue;
-                                        break;
-                                    default: break;
-                                }
-                                break;
-                                case '4': switch (obisCode[0])
-                                {
-                                    case '2': 
-                                        momentaryReactiveExportL1 = obisValue;
-                                        break;
-                                    case '4': 
-                                        momentaryReactiveExportL2 = obisValue;
-                                        break;
-                                    case '6': 
-                                        momentaryReactiveExportL3 = obisValue;
-                                        break;
-                                    default: break;
-                                }
-                                break;
-                                default: break;
-                            }
-                        }
-                        break;
-                        default: break;
+                        to[n++] = (char) (high << 4 | low);
                     }
                 }
+                else
+                {
+                    n = (uint8_t) (len < capacity ? len : capacity);
+                    memcpy(to, from, n);
+                }
+
+                textLen[entry->slot] = n;
+                textsToSend |= 1 << entry->slot;
             }
 
-            // Limitations: 
-            //   Numbers larger than 2G will fail (but spec only goes to 99999999.999 so ok)
-            //   And numbers have no more than 3 decimals in the spec.
-            //   spec == Swedish spec for H1
-            double simpleatof(const char* value)
+            const char* getText(uint8_t textSlot) const
             {
-                double decFactors[10] = {10.0, 100.0, 1000.0, 100000.0,
-                                        1000000.0, 10000000.0, 100000000.0,
-                                        1000000000.0, 10000000000.0,
-                                        100000000000.0};
-                int idx = 0;
-                int intPart = 0;
-                bool negative = false;
+                return texts + textOffset(textSlot);
+            }
 
-                if (value[idx] == '-')
-                {
-                    negative = true;
-                    idx++;
-                }
+            static int hexDigit(char c)
+            {
+                if (c >= '0' && c <= '9')
+                    return c - '0';
+                if (c >= 'A' && c <= 'F')
+                    return c - 'A' + 10;
+                if (c >= 'a' && c <= 'f')
+                    return c - 'a' + 10;
+                return -1;
+            }
 
-                while (value[idx] != '.')
+            // The momentary slots only hold 32 bits, a value past that leaves its slot as it was
+            NumberResult setValue(uint8_t slot, int64_t milli)
+            {
+                if (slot < CUMULATIVE_SLOTS)
                 {
-                    intPart = intPart*10 + (value[idx]-'0');
-                    idx++;
+                    cumulative[slot] = milli;
                 }
-
-                int len = strlen(value), startIdx = ++idx;
-                int decPart = 0;
-                while (idx < len)
+                else
                 {
-                    decPart = decPart*10 + (value[idx]-'0');
-                    idx++;
+                    if (milli < INT32_MIN || milli > INT32_MAX)
+                        return NUMBER_OVERFLOW;
+                    momentary[slot - CUMULATIVE_SLOTS] = (int32_t) milli;
                 }
+                sensorsToSend |= slotBit(slot);
+                return NUMBER_OK;
+            }
 
-                if (negative)
-                {
-                    return -(intPart + decPart/decFactors[len-startIdx-1]);
-                }
+            int64_t getMilli(uint8_t slot) const
+            {
+                if (slot < CUMULATIVE_SLOTS)
+                    return cumulative[slot];
                 else
-                {
-                    return intPart + decPart/decFactors[len-startIdx-1];
-                }
+                    return momentary[slot - CUMULATIVE_SLOTS];
+            }
+
+            float getValue(uint8_t slot) const
+            {
+                if (slot < CUMULATIVE_SLOTS)
+                    return toFloat(cumulative[slot]);
+                else
+                    return toFloat(momentary[slot - CUMULATIVE_SLOTS]);
+            }
+
+            static float toFloat(int32_t milli)
+            {
+                return (float) milli / 1000.0f;
+            }
+
+            static float toFloat(int64_t milli)
+            {
+                return (float) milli / 1000.0f;
             }
 
             void initNewTelegram()
             {
                 crc = 0x0000;
+                crcClosed = false;
                 telegramComplete = false;
                 crcOk = false;
-                sensorsToSend = 26;
+                sensorsToSend = 0;
+                textsToSend = 0;
             }
 
-            void updateCrc16(uint8_t a)
+            // Folds a chunk of the telegram into the CRC as it is read. The CRC
+            // covers everything up to and including the '!' of the CRC line.
+            void updateCrc16(const char* data, size_t len)
             {
-                int i;
-                crc ^= a;
-                for (i = 0; i < 8; ++i)
+                if (crcClosed)
+                    return;
+
+                const char* end = (const char*) memchr(data, '!', len);
+                if (end != NULL)
                 {
-                    if (crc & 1)
-                    {
-                        crc = (crc >> 1) ^ 0xA001;
-                    }
-                    else
-                    {
-                        crc = (crc >> 1);
-                    }
+                    len = end - data + 1;
+                    crcClosed = true;
                 }
+
+                crc = crc16Update(CRC16_ARC, crc, (const uint8_t*) data, len);
             }
             
             void checkCrc(uint16_t crcFromMessage)
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        // Decides whether a new value is worth a publish_state, from the deadband and
+        // max_interval options of a sensor. Without either option every value is published.
+        struct PublishFilter
+        {
+            int64_t lastValue{0};       // milli-units, as last published
+            uint32_t lastPublishMs{0};
+            uint32_t maxIntervalMs{0};  // 0 = no max age
+            int32_t deadband{0};        // milli-units, or hundredths of a percent
+            bool percent{false};
+            bool enabled{false};
+            bool published{false};
+
+            void configure(int32_t deadband, bool percent, uint32_t maxIntervalMs)
+            {
+                this->deadband = deadband;
+                this->percent = percent;
+                this->maxIntervalMs = maxIntervalMs;
+                enabled = true;
+            }
+
+            bool shouldPublish(int64_t value, uint32_t now) const
+            {
+                if (!enabled || !published)
+                    return true;
+
+                if (maxIntervalMs > 0 && now - lastPublishMs >= maxIntervalMs)
+                    return true;
+
+                int64_t change = value > lastValue ? value - lastValue : lastValue - value;
+                if (percent)
+                {
+                    int64_t base = lastValue < 0 ? -lastValue : lastValue;
+                    return change * 10000 > base * deadband;
+                }
+                return change > deadband;
+            }
+
+            void markPublished(int64_t value, uint32_t now)
+            {
+                lastValue = value;
+                lastPublishMs = now;
+                published = true;
+            }
+        };
+    }
+}
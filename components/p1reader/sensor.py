@@ -4,24 +4,47 @@ from esphome.components import sensor
 from esphome.const import (
     CONF_ID,
     DEVICE_CLASS_CURRENT,
+    DEVICE_CLASS_DURATION,
     DEVICE_CLASS_ENERGY,
+    DEVICE_CLASS_GAS,
     DEVICE_CLASS_POWER,
     DEVICE_CLASS_REACTIVE_ENERGY,
     DEVICE_CLASS_REACTIVE_POWER,
     DEVICE_CLASS_VOLTAGE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     STATE_CLASS_MEASUREMENT,
     STATE_CLASS_TOTAL_INCREASING,
     UNIT_AMPERE,
+    UNIT_CUBIC_METER,
     UNIT_KILOWATT,
     UNIT_KILOWATT_HOURS,
     UNIT_KILOVOLT_AMPS_REACTIVE_HOURS,
     UNIT_KILOVOLT_AMPS_REACTIVE,
+    UNIT_MILLISECOND,
     UNIT_VOLT,
 )
 from . import P1Reader, CONF_P1READER_ID
 
 AUTO_LOAD = ["p1reader"]
 
+CONF_DEADBAND = "deadband"
+CONF_MAX_INTERVAL = "max_interval"
+
+
+def deadband(value):
+    """Absolute change in the unit of the sensor ("0.05"), or relative to the last published value ("2%")."""
+    if isinstance(value, str) and value.strip().endswith("%"):
+        return (cv.positive_float(value.strip()[:-1]), True)
+    return (cv.positive_float(value), False)
+
+
+PUBLISH_FILTER_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_DEADBAND): deadband,
+        cv.Optional(CONF_MAX_INTERVAL): cv.positive_time_period_milliseconds,
+    }
+)
+
 
 def energy_schema():
     return sensor.sensor_schema(
@@ -77,11 +100,62 @@ def current_schema():
     )
 
 
+def mbus_schema():
+    # Mostly gas, override unit_of_measurement and device_class for water or heat
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_CUBIC_METER,
+        accuracy_decimals=3,
+        device_class=DEVICE_CLASS_GAS,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+    )
+
+
+def count_schema(state_class=STATE_CLASS_TOTAL_INCREASING):
+    def schema():
+        return sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=state_class,
+        )
+
+    return schema
+
+
+def diagnostic_schema(unit=None, decimals=0, device_class=None, state_class=STATE_CLASS_MEASUREMENT):
+    def schema():
+        return sensor.sensor_schema(
+            unit_of_measurement=unit,
+            accuracy_decimals=decimals,
+            device_class=device_class,
+            state_class=state_class,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        )
+
+    return schema
+
+
+# Published once a minute, see Diagnostics (diagnostics.h)
+DIAGNOSTIC_TYPES = {
+    "telegrams_per_minute": diagnostic_schema("telegrams/min", 1),
+    "crc_failures": diagnostic_schema(state_class=STATE_CLASS_TOTAL_INCREASING),
+    "frame_errors": diagnostic_schema(state_class=STATE_CLASS_TOTAL_INCREASING),
+    "max_update_time": diagnostic_schema(UNIT_MILLISECOND, 1, DEVICE_CLASS_DURATION),
+    "publish_latency": diagnostic_schema(UNIT_MILLISECOND, 0, DEVICE_CLASS_DURATION),
+    "uart_high_water": diagnostic_schema("B"),
+}
+
 SENSOR_TYPES = {
     "cumulative_active_import": energy_schema,
     "cumulative_active_export": energy_schema,
     "cumulative_reactive_import": reactive_energy_schema,
     "cumulative_reactive_export": reactive_energy_schema,
+    "cumulative_active_import_t1": energy_schema,
+    "cumulative_active_import_t2": energy_schema,
+    "cumulative_active_export_t1": energy_schema,
+    "cumulative_active_export_t2": energy_schema,
+    "mbus_1_reading": mbus_schema,
+    "mbus_2_reading": mbus_schema,
+    "mbus_3_reading": mbus_schema,
+    "mbus_4_reading": mbus_schema,
     "momentary_active_import": power_schema,
     "momentary_active_export": power_schema,
     "momentary_reactive_import": reactive_power_schema,
@@ -104,15 +178,25 @@ SENSOR_TYPES = {
     "current_l1": current_schema,
     "current_l2": current_schema,
     "current_l3": current_schema,
+    "tariff": count_schema(STATE_CLASS_MEASUREMENT),
+    "power_failures": count_schema(),
+    "long_power_failures": count_schema(),
+    "voltage_sags_l1": count_schema(),
+    "voltage_sags_l2": count_schema(),
+    "voltage_sags_l3": count_schema(),
+    "voltage_swells_l1": count_schema(),
+    "voltage_swells_l2": count_schema(),
+    "voltage_swells_l3": count_schema(),
 }
 
 CONFIG_SCHEMA = cv.Schema(
     {
         cv.GenerateID(CONF_P1READER_ID): cv.use_id(P1Reader),
         **{
-            cv.Optional(name): factory()
+            cv.Optional(name): factory().extend(PUBLISH_FILTER_SCHEMA)
             for name, factory in SENSOR_TYPES.items()
         },
+        **{cv.Optional(name): factory() for name, factory in DIAGNOSTIC_TYPES.items()},
     }
 ).extend(cv.COMPONENT_SCHEMA)
 
@@ -125,4 +209,25 @@ async def to_code(config):
         id = conf[CONF_ID]
         if id and id.type == sensor.Sensor:
             sens = await sensor.new_sensor(conf)
+            if key in DIAGNOSTIC_TYPES:
+                cg.add(getattr(hub, f"set_diagnostic_{key}")(sens))
+                continue
+
             cg.add(getattr(hub, f"set_sensor_{key}")(sens))
+            # Only OBIS codes with a sensor are compiled into OBIS_TABLE (obis_table.h)
+            cg.add_define("P1READER_OBIS_FILTER")
+            cg.add_define(f"P1READER_OBIS_{key.upper()}")
+
+            if CONF_DEADBAND in conf or CONF_MAX_INTERVAL in conf:
+                amount, percent = conf.get(CONF_DEADBAND, (0.0, False))
+                # Deadbands are compared in milli-units, or in hundredths of a percent
+                scaled = round(amount * (100 if percent else 1000))
+                max_interval = conf.get(CONF_MAX_INTERVAL)
+                cg.add(
+                    hub.set_publish_filter(
+                        cg.RawExpression(f"esphome::p1_reader::SLOT_{key.upper()}"),
+                        scaled,
+                        percent,
+                        max_interval.total_milliseconds if max_interval else 0,
+                    )
+                )
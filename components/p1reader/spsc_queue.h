@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        // Lock-free queue between exactly one producer and one consumer task. The consumer
+        // works on front() in place until it pop()s it, and neither side ever blocks the other.
+        template <typename T, uint32_t N>
+        class SpscQueue
+        {
+            static_assert((N & (N - 1)) == 0, "N has to be a power of two");
+
+        public:
+            // Producer: copies item in, false when the queue is full
+            bool push(const T &item)
+            {
+                uint32_t head = _head.load(std::memory_order_relaxed);
+                if (head - _tail.load(std::memory_order_acquire) == N)
+                    return false;
+
+                _items[head % N] = item;
+                _head.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Consumer: oldest item, nullptr when the queue is empty
+            T *front()
+            {
+                uint32_t tail = _tail.load(std::memory_order_relaxed);
+                if (_head.load(std::memory_order_acquire) == tail)
+                    return nullptr;
+
+                return &_items[tail % N];
+            }
+
+            // Consumer: done with front(), the producer may reuse it
+            void pop()
+            {
+                _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+        protected:
+            T _items[N];
+            std::atomic<uint32_t> _head{0};  // written by the producer only
+            std::atomic<uint32_t> _tail{0};  // written by the consumer only
+        };
+    }
+}
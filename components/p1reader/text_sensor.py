@@ -0,0 +1,43 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import text_sensor
+from esphome.const import ENTITY_CATEGORY_DIAGNOSTIC
+from . import P1Reader, CONF_P1READER_ID
+
+AUTO_LOAD = ["p1reader"]
+
+
+def text_schema(entity_category=None):
+    def schema():
+        return text_sensor.text_sensor_schema(entity_category=entity_category)
+
+    return schema
+
+
+# In the order of P1TextSlot (obis_table.h). Only ASCII telegrams carry these.
+TEXT_SENSOR_TYPES = {
+    "timestamp": text_schema(),
+    "equipment_id": text_schema(ENTITY_CATEGORY_DIAGNOSTIC),
+    "dsmr_version": text_schema(ENTITY_CATEGORY_DIAGNOSTIC),
+    "message": text_schema(),
+    "mbus_1_timestamp": text_schema(),
+    "mbus_2_timestamp": text_schema(),
+    "mbus_3_timestamp": text_schema(),
+    "mbus_4_timestamp": text_schema(),
+}
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_P1READER_ID): cv.use_id(P1Reader),
+        **{cv.Optional(name): factory() for name, factory in TEXT_SENSOR_TYPES.items()},
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    hub = await cg.get_variable(config[CONF_P1READER_ID])
+
+    for key in TEXT_SENSOR_TYPES:
+        if key in config:
+            sens = await text_sensor.new_text_sensor(config[key])
+            cg.add(getattr(hub, f"set_text_sensor_{key}")(sens))
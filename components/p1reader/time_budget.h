@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esphome/core/hal.h"
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        // The kinds of work update() is split into. Each has its own cost estimate,
+        // a published sensor costs a lot more than reading a line.
+        enum BudgetPhase : uint8_t
+        {
+            PHASE_READ,     // one ASCII line or one chunk of an HDLC frame
+            PHASE_PUBLISH,  // one publish_state
+            PHASE_COUNT
+        };
+
+        // Keeps one update() call under a time budget. Every step of work is timed with
+        // micros() and another step is only started when the estimated cost of it still
+        // fits, so we stop just before going over instead of just after.
+        class TimeBudget
+        {
+        public:
+            void setBudgetUs(uint32_t budgetUs)
+            {
+                _budgetUs = budgetUs;
+            }
+
+            uint32_t budgetUs() const
+            {
+                return _budgetUs;
+            }
+
+            uint32_t estimateUs(BudgetPhase phase) const
+            {
+                return _estimateUs[phase];
+            }
+
+            void startSlice()
+            {
+                _sliceStart = micros();
+                _stepStart = _sliceStart;
+                _phasesStepped = 0;
+            }
+
+            // Call when a step of phase is done. Returns true when another one fits in the slice.
+            bool stepDone(BudgetPhase phase)
+            {
+                uint32_t now = micros();
+                uint32_t cost = now - _stepStart;
+                _stepStart = now;
+                _phasesStepped |= 1 << phase;
+
+                // Go up at once, come down slowly, a slow step is the one that bites. One
+                // step over the whole budget counts as the budget, or it would take ages to
+                // come down again.
+                if (cost > _budgetUs)
+                    cost = _budgetUs;
+                uint32_t &estimate = _estimateUs[phase];
+                if (cost > estimate)
+                    estimate = cost;
+                else
+                    estimate -= (estimate - cost) / 8;
+
+                return fits(phase);
+            }
+
+            // Starts a new step without accounting the time since the last one (waiting on the UART)
+            void skipStep()
+            {
+                _stepStart = micros();
+            }
+
+            // The first step of each phase in a slice always fits, so however bad the
+            // estimate every phase keeps making progress
+            bool fits(BudgetPhase phase) const
+            {
+                if ((_phasesStepped & (1 << phase)) == 0)
+                    return true;
+                return elapsedUs() + _estimateUs[phase] <= _budgetUs;
+            }
+
+            uint32_t elapsedUs() const
+            {
+                return micros() - _sliceStart;
+            }
+
+        protected:
+            uint32_t _budgetUs{20000};
+            uint32_t _sliceStart{0};
+            uint32_t _stepStart{0};
+            uint32_t _estimateUs[PHASE_COUNT]{0, 0};
+            uint8_t _phasesStepped{0};  // phases with a step done in this slice
+        };
+    }
+}
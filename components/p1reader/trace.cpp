@@ -0,0 +1,68 @@
+#include "trace.h"
+
+#ifdef P1READER_TRACE_RING
+
+#include "esphome/core/hal.h"
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        TraceRing traceRing;
+
+        void TraceRing::record(TraceEvent event, uint32_t a, int32_t b)
+        {
+#ifdef USE_ESP32
+            uint32_t index = _next.fetch_add(1, std::memory_order_relaxed);
+#else
+            uint32_t index = _next++;
+#endif
+            TraceRecord &record = _records[index % P1READER_TRACE_RING_SIZE];
+            record.us = micros();
+            record.a = a;
+            record.b = b;
+            record.event = event;
+        }
+
+        void TraceRing::dump()
+        {
+            uint32_t next = _next;
+            uint32_t recorded = next - _dumped;
+            uint32_t count = recorded < P1READER_TRACE_RING_SIZE ? recorded : P1READER_TRACE_RING_SIZE;
+            ESP_LOGI("trace", "%u events, %u recorded since the last dump", (unsigned) count, (unsigned) recorded);
+
+            for (uint32_t i = next - count; i != next; i++)
+            {
+                const TraceRecord &record = _records[i % P1READER_TRACE_RING_SIZE];
+                unsigned us = (unsigned) record.us;
+                unsigned a = (unsigned) record.a;
+                switch (record.event)
+                {
+                    case TRACE_LINE:
+                        ESP_LOGI("trace", "%10u us  line, %u bytes", us, a);
+                        break;
+                    case TRACE_PARTIAL_LINE:
+                        ESP_LOGI("trace", "%10u us  partial line, %u bytes", us, a);
+                        break;
+                    case TRACE_READ_PAUSED:
+                        ESP_LOGI("trace", "%10u us  out of time reading, %u bytes staged", us, a);
+                        break;
+                    case TRACE_PARSE_PAUSED:
+                        ESP_LOGI("trace", "%10u us  out of time parsing, at offset %u", us, a);
+                        break;
+                    case TRACE_FRAME_READ:
+                        ESP_LOGI("trace", "%10u us  frame read, FCS %04X", us, a);
+                        break;
+                    case TRACE_VALUE:
+                        ESP_LOGI("trace", "%10u us  value %u.%u.%u = %d (milli)", us,
+                                (a >> 16) & 0xff, (a >> 8) & 0xff, a & 0xff, (int) record.b);
+                        break;
+                }
+            }
+
+            _dumped = next;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "esphome/core/log.h"
+
+// What the trace points on the parsing hot path (every line, frame chunk and register)
+// turn into, set with trace in YAML:
+//   P1READER_TRACE_LOG   formatted inline with ESP_LOGD/ESP_LOGV (default)
+//   P1READER_TRACE_NONE  compiled out, format strings and all
+//   P1READER_TRACE_RING  compact binary events in a ring buffer, formatted by dump_trace()
+#if !defined(P1READER_TRACE_LOG) && !defined(P1READER_TRACE_NONE) && !defined(P1READER_TRACE_RING)
+#define P1READER_TRACE_LOG
+#endif
+
+#ifndef P1READER_TRACE_RING_SIZE
+#define P1READER_TRACE_RING_SIZE 64
+#endif
+
+// P1_TRACE(level, event, a, b, tag, format, ...)
+// level, tag and format are what gets logged with trace: log, event, a and b what gets
+// recorded with trace: ring. Whatever the mode doesn't use is never evaluated.
+#if defined(P1READER_TRACE_RING)
+#define P1_TRACE(level, event, a, b, tag, ...) \
+    ::esphome::p1_reader::traceRing.record(::esphome::p1_reader::event, a, b)
+#elif defined(P1READER_TRACE_LOG)
+#define P1_TRACE(level, event, a, b, tag, ...) ESP_LOG##level(tag, __VA_ARGS__)
+#else
+#define P1_TRACE(level, event, a, b, tag, ...) do {} while (0)
+#endif
+
+namespace esphome
+{
+    namespace p1_reader
+    {
+        enum TraceEvent : uint8_t
+        {
+            TRACE_LINE,           // a: length of an ASCII line
+            TRACE_PARTIAL_LINE,   // a: bytes of the line so far
+            TRACE_READ_PAUSED,    // out of time while reading, a: bytes still staged
+            TRACE_PARSE_PAUSED,   // out of time while parsing a captured telegram, a: offset
+            TRACE_FRAME_READ,     // a: FCS of an HDLC frame that passed
+            TRACE_VALUE,          // a: OBIS key (obis_table.h), b: value in milli-units
+        };
+
+#ifdef P1READER_TRACE_RING
+        struct TraceRecord
+        {
+            uint32_t us;
+            uint32_t a;
+            int32_t b;
+            TraceEvent event;
+        };
+
+        // The last P1READER_TRACE_RING_SIZE events, recording one is a handful of stores
+        class TraceRing
+        {
+        public:
+            void record(TraceEvent event, uint32_t a, int32_t b);
+
+            // Logs the events recorded since the last dump, oldest first
+            void dump();
+
+        protected:
+            TraceRecord _records[P1READER_TRACE_RING_SIZE];
+#ifdef USE_ESP32
+            // The reader task and readers on the main loop may be recording at the same time
+            std::atomic<uint32_t> _next{0};
+#else
+            uint32_t _next{0};
+#endif
+            // Only dump() touches it, _next is never reset under a recording reader
+            uint32_t _dumped{0};
+        };
+
+        extern TraceRing traceRing;
+#endif
+    }
+}